@@ -0,0 +1,408 @@
+// Headless physics benchmark: runs PhysicsEngine without a window over a set
+// of scenarios, body counts and thread counts, and prints the results as JSON.
+//
+//   physics-benchmark [--scenarios a,b] [--bodies 1000,10000] [--threads 1,4]
+//                     [--steps N] [--warmup N] [--broadphase hash|sap]
+//                     [--skin metres] [--reorder steps] [--theta angle]
+//                     [--output file.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/JobSystem.h"
+#include "physics/PhysicsEngine.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const float physicsStep = 1.0f / 120.0f;
+const unsigned sceneSeed = 12345;
+
+struct Options {
+    std::vector<std::string> scenarios = {"spheres", "pile", "gas"};
+    std::vector<uint32_t> bodies = {1000, 10000, 100000, 1000000};
+    std::vector<unsigned> threads;
+    int steps = 0; // 0 picks a count from the body count
+    int warmup = 10;
+    BroadphaseType broadphase = BroadphaseType::SpatialHash;
+    float skin = 0.0f;
+    uint32_t reorder = 0;
+    float theta = 0.5f;
+    std::string output;
+};
+
+struct Result {
+    std::string scenario;
+    uint32_t bodies;
+    unsigned threads;
+    int steps;
+    double seconds;
+    double averagePairs;
+    double averageContacts;
+    uint32_t broadphaseRebuilds;
+    uint32_t awakeBodies;
+    uint64_t peakMemory;
+    StepProfile profile; // averaged over the timed steps
+};
+
+// Keeps the spawn volume growing with the body count so every size runs at
+// the density of the 50-sphere scene it is based on.
+float sceneScale(uint32_t count) {
+    return std::max(1.0f, std::cbrt(count / 50.0f));
+}
+
+// The sphere box from learning_opengl advance.cpp: random spheres thrown
+// sideways inside walls, bouncing off each other and the floor.
+void buildSpheres(PhysicsEngine& engine, uint32_t count) {
+    float scale = sceneScale(count);
+    std::mt19937 gen(sceneSeed);
+    std::uniform_real_distribution<float> posDist(-8.0f * scale, 8.0f * scale);
+    std::uniform_real_distribution<float> velDist(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> radiusDist(0.2f, 0.8f);
+    std::uniform_real_distribution<float> massDist(1.0f, 5.0f);
+
+    engine.setGravity(glm::vec3(0.0f, -9.81f, 0.0f));
+    engine.setWorldBounds(AABB(glm::vec3(-10.0f * scale, -5.0f, -10.0f * scale),
+                               glm::vec3(10.0f * scale, 20.0f * scale, 10.0f * scale)));
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 position(posDist(gen), posDist(gen) + 8.0f * scale + 3.0f, posDist(gen));
+        float radius = radiusDist(gen);
+        RigidBody body(massDist(gen), position, radius);
+        body.setVelocity(glm::vec3(velDist(gen), 0.0f, velDist(gen)));
+        body.setRestitution(0.8f);
+        engine.addRigidBody(body);
+    }
+}
+
+// Mixed shapes dropped onto a ground plane; exercises GJK/EPA, the solver
+// and sleeping as the pile settles.
+void buildPile(PhysicsEngine& engine, uint32_t count) {
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(count / 4.0f)));
+    std::mt19937 gen(sceneSeed);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+
+    engine.setGravity(glm::vec3(0.0f, -9.81f, 0.0f));
+    RigidBody ground(0.0f, glm::vec3(0.0f));
+    ground.setCollider(Collider::plane(glm::vec3(0.0f, 1.0f, 0.0f)));
+    engine.addRigidBody(ground);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t column = i % (side * side);
+        uint32_t layer = i / (side * side);
+        glm::vec3 position((column % side) * 1.1f - side * 0.55f + jitter(gen), 0.6f + layer * 1.1f,
+                           (column / side) * 1.1f - side * 0.55f + jitter(gen));
+        RigidBody body(1.0f, position, 0.45f);
+        if (i % 3 == 1) {
+            body.setCollider(Collider::box(glm::vec3(0.4f)));
+        } else if (i % 3 == 2) {
+            body.setCollider(Collider::capsule(0.2f, 0.25f));
+        }
+        body.setRestitution(0.1f);
+        engine.addRigidBody(body);
+    }
+}
+
+// Sparse spheres drifting without gravity: mostly broadphase and
+// integration, few contacts, nothing ever sleeps.
+void buildGas(PhysicsEngine& engine, uint32_t count) {
+    float half = 20.0f * sceneScale(count);
+    std::mt19937 gen(sceneSeed);
+    std::uniform_real_distribution<float> posDist(-half, half);
+    std::uniform_real_distribution<float> velDist(-3.0f, 3.0f);
+
+    engine.setGravity(glm::vec3(0.0f));
+    engine.setSleepEnabled(false);
+    engine.setWorldBounds(AABB(glm::vec3(-half - 1.0f), glm::vec3(half + 1.0f)));
+    for (uint32_t i = 0; i < count; ++i) {
+        RigidBody body(1.0f, glm::vec3(posDist(gen), posDist(gen), posDist(gen)), 0.3f);
+        body.setVelocity(glm::vec3(velDist(gen), velDist(gen), velDist(gen)));
+        body.setRestitution(1.0f);
+        engine.addRigidBody(body);
+    }
+}
+
+// A flat, rotating disc of small bodies held together by their own gravity
+// through the Barnes-Hut pass; few contacts, no external gravity.
+void buildGalaxy(PhysicsEngine& engine, uint32_t count) {
+    float radius = 20.0f * sceneScale(count);
+    float strength = 1.0f;
+    std::mt19937 gen(sceneSeed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    engine.setGravity(glm::vec3(0.0f));
+    engine.setSleepEnabled(false);
+    engine.setMutualForce(strength, 0.5f);
+    for (uint32_t i = 0; i < count; ++i) {
+        // Uniform over the disc, on roughly circular orbits around the mass
+        // inside each radius.
+        float r = radius * std::sqrt(unit(gen));
+        float angle = 6.2831853f * unit(gen);
+        glm::vec3 position(r * std::cos(angle), (unit(gen) - 0.5f) * 0.05f * radius, r * std::sin(angle));
+        float enclosed = static_cast<float>(count) * (r * r) / (radius * radius);
+        float speed = std::sqrt(strength * enclosed / std::max(r, 1.0f));
+        RigidBody body(1.0f, position, 0.1f);
+        body.setVelocity(glm::vec3(-std::sin(angle), 0.0f, std::cos(angle)) * speed);
+        engine.addRigidBody(body);
+    }
+}
+
+void buildScenario(const std::string& name, PhysicsEngine& engine, uint32_t count) {
+    if (name == "spheres") {
+        buildSpheres(engine, count);
+    } else if (name == "pile") {
+        buildPile(engine, count);
+    } else if (name == "galaxy") {
+        buildGalaxy(engine, count);
+    } else {
+        buildGas(engine, count);
+    }
+}
+
+// Resets the peak so each run reports its own high-water mark, where the
+// platform allows it; otherwise the peak is process-wide and only grows.
+void resetPeakMemory() {
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif
+}
+
+uint64_t peakMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        }
+    }
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+Result runBenchmark(const std::string& scenario, uint32_t count, unsigned threads, const Options& options) {
+    resetPeakMemory();
+    JobSystem jobs(threads);
+    Result result = {scenario, count, threads, 0, 0.0, 0.0, 0.0, 0, 0, 0, StepProfile()};
+    {
+        PhysicsEngine engine;
+        engine.setBroadphase(options.broadphase);
+        engine.setBroadphaseSkin(options.skin);
+        engine.setReorderInterval(options.reorder);
+        engine.setBarnesHutTheta(options.theta);
+        engine.setJobSystem(&jobs);
+        buildScenario(scenario, engine, count);
+
+        // Aim for a few seconds per run whatever the size.
+        int steps = options.steps > 0 ? options.steps : static_cast<int>(std::clamp(2000000u / count, 5u, 500u));
+        for (int i = 0; i < options.warmup; ++i) {
+            engine.update(physicsStep);
+        }
+
+        engine.getProfiler().setHistorySize(steps);
+
+        uint64_t pairs = 0;
+        uint64_t contacts = 0;
+        uint32_t rebuilds = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < steps; ++i) {
+            engine.update(physicsStep);
+            pairs += engine.getCandidatePairs().size();
+            contacts += engine.getContactCount();
+            rebuilds += engine.getProfiler().getLastStep().broadphaseRebuilds;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        result.steps = steps;
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.averagePairs = static_cast<double>(pairs) / steps;
+        result.averageContacts = static_cast<double>(contacts) / steps;
+        result.broadphaseRebuilds = rebuilds;
+        result.awakeBodies = engine.getAwakeBodyCount();
+        result.profile = engine.getProfiler().getAverage();
+        result.peakMemory = peakMemory();
+        engine.setJobSystem(nullptr);
+    }
+    return result;
+}
+
+template <typename T>
+bool parseList(const std::string& text, std::vector<T>& values) {
+    values.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::stringstream parser(item);
+        T value;
+        if (!(parser >> value)) {
+            return false;
+        }
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--scenarios") {
+            ok = parseList(value, options.scenarios);
+        } else if (arg == "--bodies") {
+            ok = parseList(value, options.bodies);
+        } else if (arg == "--threads") {
+            ok = parseList(value, options.threads);
+        } else if (arg == "--steps") {
+            options.steps = std::atoi(value.c_str());
+        } else if (arg == "--warmup") {
+            options.warmup = std::max(0, std::atoi(value.c_str()));
+        } else if (arg == "--broadphase") {
+            ok = value == "hash" || value == "sap";
+            options.broadphase = value == "sap" ? BroadphaseType::SweepAndPrune : BroadphaseType::SpatialHash;
+        } else if (arg == "--skin") {
+            options.skin = static_cast<float>(std::atof(value.c_str()));
+        } else if (arg == "--theta") {
+            options.theta = static_cast<float>(std::atof(value.c_str()));
+        } else if (arg == "--reorder") {
+            options.reorder = static_cast<uint32_t>(std::max(0, std::atoi(value.c_str())));
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Bad argument: " << arg << " " << value << std::endl;
+            return false;
+        }
+    }
+    for (const std::string& scenario : options.scenarios) {
+        if (scenario != "spheres" && scenario != "pile" && scenario != "gas" && scenario != "galaxy") {
+            std::cerr << "Unknown scenario: " << scenario << std::endl;
+            return false;
+        }
+    }
+    if (options.threads.empty()) {
+        // 1, 2, 4, ... up to the machine, plus the machine itself.
+        unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 1; t < hardware; t *= 2) {
+            options.threads.push_back(t);
+        }
+        options.threads.push_back(hardware);
+    }
+    options.bodies.erase(std::remove(options.bodies.begin(), options.bodies.end(), 0u), options.bodies.end());
+    return !options.bodies.empty();
+}
+
+void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results) {
+    out << "{\n";
+    out << "  \"broadphase\": \"" << (options.broadphase == BroadphaseType::SweepAndPrune ? "sap" : "hash") << "\",\n";
+    out << "  \"skin\": " << options.skin << ",\n";
+    out << "  \"reorderInterval\": " << options.reorder << ",\n";
+    out << "  \"theta\": " << options.theta << ",\n";
+    out << "  \"stepSeconds\": " << physicsStep << ",\n";
+    out << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        // Speedup is against the single-thread run of the same scenario and
+        // size, when there is one.
+        double baseline = 0.0;
+        for (const Result& other : results) {
+            if (other.scenario == r.scenario && other.bodies == r.bodies && other.threads == 1) {
+                baseline = other.seconds / other.steps;
+            }
+        }
+        double stepsPerSecond = r.steps / r.seconds;
+        out << "    {\"scenario\": \"" << r.scenario << "\", \"bodies\": " << r.bodies
+            << ", \"threads\": " << r.threads << ", \"steps\": " << r.steps
+            << ", \"stepsPerSecond\": " << stepsPerSecond
+            << ", \"msPerStep\": " << 1000.0 * r.seconds / r.steps
+            << ", \"bodyStepsPerSecond\": " << stepsPerSecond * r.bodies
+            << ", \"candidatePairs\": " << r.averagePairs
+            << ", \"contacts\": " << r.averageContacts
+            << ", \"broadphaseRebuilds\": " << r.broadphaseRebuilds
+            << ", \"pairsTested\": " << r.profile.pairsTested
+            << ", \"awakeBodies\": " << r.awakeBodies
+            << ", \"islands\": " << r.profile.islands
+            << ", \"peakMemoryBytes\": " << r.peakMemory;
+        if (baseline > 0.0) {
+            out << ", \"speedup\": " << baseline * stepsPerSecond;
+        }
+        out << ", \"phasesMs\": {";
+        for (size_t p = 0; p < static_cast<size_t>(PhysicsPhase::Count); ++p) {
+            PhysicsPhase phase = static_cast<PhysicsPhase>(p);
+            out << (p ? ", " : "") << "\"" << getPhysicsPhaseName(phase) << "\": " << r.profile.getPhaseMs(phase);
+        }
+        out << "}";
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (const std::string& scenario : options.scenarios) {
+        for (uint32_t count : options.bodies) {
+            for (unsigned threads : options.threads) {
+                std::cerr << scenario << " " << count << " bodies, " << threads << " threads..." << std::flush;
+                results.push_back(runBenchmark(scenario, count, threads, options));
+                const Result& r = results.back();
+                std::cerr << " " << 1000.0 * r.seconds / r.steps << " ms/step" << std::endl;
+            }
+        }
+    }
+
+    if (options.output.empty()) {
+        writeJson(std::cout, options, results);
+    } else {
+        std::ofstream file(options.output);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << options.output << std::endl;
+            return 1;
+        }
+        writeJson(file, options, results);
+    }
+    return 0;
+}
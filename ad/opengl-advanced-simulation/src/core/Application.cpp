@@ -3,7 +3,7 @@
 #include "Renderer.h"
 
 Application::Application(const std::string& title, int width, int height)
-    : window(title, width, height), renderer() {
+    : window(title, width, height), renderer(), physicsThread(physics), threadedPhysics(false), timestep(60.0f, 5) {
 }
 
 void Application::initialize() {
@@ -12,14 +12,56 @@ void Application::initialize() {
 }
 
 void Application::run() {
+    if (threadedPhysics) {
+        physicsThread.start();
+    }
+    double lastTime = glfwGetTime();
     while (!window.shouldClose()) {
+        double currentTime = glfwGetTime();
+        float frameTime = static_cast<float>(currentTime - lastTime);
+        lastTime = currentTime;
+
         window.pollEvents();
+
+        if (threadedPhysics) {
+            physicsThread.getInterpolatedPositions(renderPositions);
+        } else {
+            int steps = timestep.advance(frameTime);
+            for (int i = 0; i < steps; ++i) {
+                physics.update(timestep.getStep());
+            }
+            physics.getInterpolatedPositions(timestep.getAlpha(), renderPositions);
+        }
+
         renderer.render();
         window.swapBuffers();
     }
+    physicsThread.stop();
 }
 
 void Application::cleanup() {
     renderer.cleanup();
     window.cleanup();
-}
\ No newline at end of file
+}
+
+void Application::setPhysicsRate(float stepsPerSecond) {
+    timestep.setRate(stepsPerSecond);
+    physicsThread.setRate(stepsPerSecond);
+}
+
+void Application::setMaxPhysicsSubsteps(int maxSubsteps) {
+    timestep.setMaxSubsteps(maxSubsteps);
+    physicsThread.setMaxSubsteps(maxSubsteps);
+}
+
+void Application::setThreadedPhysics(bool threaded) {
+    threadedPhysics = threaded;
+}
+
+PhysicsEngine& Application::getPhysics() {
+    return physics;
+}
+
+PhysicsThread& Application::getPhysicsThread() {
+    return physicsThread;
+}
@@ -1,19 +1,42 @@
 #ifndef APPLICATION_H
 #define APPLICATION_H
 
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
 #include "Window.h"
+#include "FixedTimestep.h"
+#include "PhysicsThread.h"
+#include "renderer/Renderer.h"
+#include "physics/PhysicsEngine.h"
 
 class Application {
 public:
-    Application();
-    ~Application();
+    Application(const std::string& title = "OpenGL Advanced Simulation", int width = 1280, int height = 720);
 
-    void init();
+    void initialize();
     void run();
     void cleanup();
 
+    // Physics runs at this rate no matter how fast frames are drawn.
+    void setPhysicsRate(float stepsPerSecond);
+    void setMaxPhysicsSubsteps(int maxSubsteps);
+    // Steps physics on its own thread instead of before each draw; set
+    // before run(). While it runs, touch the engine through
+    // getPhysicsThread().post() only.
+    void setThreadedPhysics(bool threaded);
+    PhysicsEngine& getPhysics();
+    PhysicsThread& getPhysicsThread();
+
 private:
-    Window* window;
+    Window window;
+    Renderer renderer;
+    PhysicsEngine physics;
+    PhysicsThread physicsThread;
+    bool threadedPhysics;
+    FixedTimestep timestep;
+    // Body positions blended between the last two physics steps, in packed order.
+    std::vector<glm::vec3> renderPositions;
 };
 
-#endif // APPLICATION_H
\ No newline at end of file
+#endif // APPLICATION_H
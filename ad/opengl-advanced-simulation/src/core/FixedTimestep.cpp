@@ -0,0 +1,38 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(float stepsPerSecond, int maxSubsteps)
+    : step(1.0f / stepsPerSecond), maxSubsteps(maxSubsteps), accumulator(0.0f) {}
+
+void FixedTimestep::setRate(float stepsPerSecond) {
+    step = 1.0f / stepsPerSecond;
+}
+
+void FixedTimestep::setMaxSubsteps(int newMaxSubsteps) {
+    maxSubsteps = std::max(1, newMaxSubsteps);
+}
+
+float FixedTimestep::getStep() const {
+    return step;
+}
+
+int FixedTimestep::advance(float frameTime) {
+    accumulator += std::max(frameTime, 0.0f);
+
+    int steps = static_cast<int>(accumulator / step);
+    if (steps > maxSubsteps) {
+        steps = maxSubsteps;
+        accumulator = 0.0f;
+    } else {
+        accumulator -= steps * step;
+    }
+    return steps;
+}
+
+float FixedTimestep::getAlpha() const {
+    return std::min(accumulator / step, 1.0f);
+}
+
+void FixedTimestep::reset() {
+    accumulator = 0.0f;
+}
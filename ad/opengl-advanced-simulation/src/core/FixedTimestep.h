@@ -0,0 +1,30 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+// Accumulates real frame time and hands it out as whole fixed steps, so the
+// simulation advances the same way at any frame rate. The time left over is
+// exposed as an interpolation factor for rendering between the last two
+// simulated states.
+class FixedTimestep {
+public:
+    explicit FixedTimestep(float stepsPerSecond = 60.0f, int maxSubsteps = 5);
+
+    void setRate(float stepsPerSecond);
+    // Cap on steps per frame; after a long hitch the extra time is dropped
+    // instead of trying to catch up and falling further behind.
+    void setMaxSubsteps(int maxSubsteps);
+    float getStep() const;
+
+    // Adds one frame worth of time and returns how many steps to run now.
+    int advance(float frameTime);
+    // Fraction of a step left in the accumulator, in [0, 1).
+    float getAlpha() const;
+    void reset();
+
+private:
+    float step;
+    int maxSubsteps;
+    float accumulator;
+};
+
+#endif // FIXED_TIMESTEP_H
@@ -0,0 +1,140 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace {
+// Queue index of the current thread: 0 for outside threads, i + 1 for worker i.
+thread_local unsigned threadQueueIndex = 0;
+thread_local const JobSystem* threadOwner = nullptr;
+}
+
+JobSystem::JobSystem(unsigned threadCount) : pendingJobs(0), running(true) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        running = false;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned JobSystem::getThreadCount() const {
+    return static_cast<unsigned>(queues.size());
+}
+
+uint32_t JobSystem::chunkCount(uint32_t count, uint32_t grainSize) {
+    grainSize = std::max(grainSize, 1u);
+    return (count + grainSize - 1) / grainSize;
+}
+
+unsigned JobSystem::currentQueue() const {
+    return threadOwner == this ? threadQueueIndex : 0;
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, const RangeFunction& function) {
+    uint32_t chunks = chunkCount(count, grainSize);
+    if (chunks == 0) {
+        return;
+    }
+
+    Batch batch;
+    batch.function = &function;
+    batch.count = count;
+    batch.grainSize = std::max(grainSize, 1u);
+    batch.remaining = chunks;
+
+    // Count the jobs before publishing them so pendingJobs never underflows.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pendingJobs += chunks;
+    }
+
+    // Deal the chunks round robin so every worker starts with local work.
+    unsigned queueCount = getThreadCount();
+    unsigned first = currentQueue();
+    for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+        WorkQueue& queue = *queues[(first + chunk) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({ &batch, chunk });
+    }
+    wakeUp.notify_all();
+
+    // Help out until our own batch is finished.
+    while (batch.remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOneJob(first)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::popJob(unsigned index, Job& job) {
+    {
+        WorkQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    unsigned queueCount = getThreadCount();
+    for (unsigned offset = 1; offset < queueCount; ++offset) {
+        WorkQueue& victim = *queues[(index + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::runOneJob(unsigned index) {
+    Job job;
+    if (!popJob(index, job)) {
+        return false;
+    }
+    pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(const Job& job) {
+    Batch& batch = *job.batch;
+    uint32_t begin = job.chunk * batch.grainSize;
+    uint32_t end = std::min(begin + batch.grainSize, batch.count);
+    (*batch.function)(begin, end);
+    batch.remaining.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(unsigned index) {
+    threadQueueIndex = index;
+    threadOwner = this;
+
+    while (true) {
+        if (runOneJob(index)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return !running || pendingJobs.load() > 0; });
+        if (!running) {
+            return;
+        }
+    }
+}
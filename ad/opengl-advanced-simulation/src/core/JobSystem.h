@@ -0,0 +1,80 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads with one deque per thread. A thread pops work
+// from the back of its own deque and steals from the front of the others when
+// it runs dry. The thread calling parallelFor takes part in the work instead
+// of blocking, so nested calls from inside a job are fine.
+class JobSystem {
+public:
+    using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+    // threadCount includes the calling thread; 0 uses every hardware thread.
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned getThreadCount() const;
+
+    // Splits [0, count) into chunks of grainSize items and blocks until every
+    // chunk ran. Chunk boundaries only depend on count and grainSize, never on
+    // the number of threads.
+    void parallelFor(uint32_t count, uint32_t grainSize, const RangeFunction& function);
+
+    // Number of chunks parallelFor would create, for sizing per-chunk output.
+    static uint32_t chunkCount(uint32_t count, uint32_t grainSize);
+
+private:
+    struct Batch {
+        const RangeFunction* function;
+        uint32_t count;
+        uint32_t grainSize;
+        std::atomic<uint32_t> remaining;
+    };
+
+    struct Job {
+        Batch* batch;
+        uint32_t chunk;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void workerLoop(unsigned index);
+    bool runOneJob(unsigned index);
+    bool popJob(unsigned index, Job& job);
+    void execute(const Job& job);
+    unsigned currentQueue() const;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<uint32_t> pendingJobs;
+    std::atomic<bool> running;
+};
+
+// Runs function over [0, count) on the job system, or inline when there is none.
+inline void parallelFor(JobSystem* jobs, uint32_t count, uint32_t grainSize, const JobSystem::RangeFunction& function) {
+    if (jobs && count > grainSize) {
+        jobs->parallelFor(count, grainSize, function);
+    } else if (count > 0) {
+        function(0, count);
+    }
+}
+
+#endif // JOB_SYSTEM_H
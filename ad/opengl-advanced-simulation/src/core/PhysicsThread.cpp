@@ -0,0 +1,131 @@
+#include "PhysicsThread.h"
+#include <algorithm>
+
+using Clock = std::chrono::steady_clock;
+
+PhysicsThread::PhysicsThread(PhysicsEngine& engine)
+    : engine(engine), running(false), step(0.0f), maxSubsteps(5) {
+    setRate(60.0f);
+}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::setRate(float stepsPerSecond) {
+    step = 1.0f / stepsPerSecond;
+    stepDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(step));
+}
+
+void PhysicsThread::setMaxSubsteps(int newMaxSubsteps) {
+    maxSubsteps = std::max(1, newMaxSubsteps);
+}
+
+void PhysicsThread::start() {
+    if (running) {
+        return;
+    }
+    // Something to draw before the first step finishes.
+    publish(Clock::now());
+    running = true;
+    thread = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::stop() {
+    if (!running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+    runCommands();
+}
+
+bool PhysicsThread::isRunning() const {
+    return running;
+}
+
+void PhysicsThread::post(Command command) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingCommands.push_back(std::move(command));
+    }
+    wake.notify_one();
+}
+
+void PhysicsThread::runCommands() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.swap(pendingCommands);
+    }
+    for (Command& command : commands) {
+        command(engine);
+    }
+    commands.clear();
+}
+
+void PhysicsThread::run() {
+    Clock::time_point due = Clock::now() + stepDuration;
+    while (running) {
+        runCommands();
+
+        Clock::time_point now = Clock::now();
+        if (now < due) {
+            // Sleep until the next step is due, or until a command or stop
+            // comes in.
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_until(lock, due, [this] { return !running || !pendingCommands.empty(); });
+            continue;
+        }
+
+        int steps = 0;
+        Clock::time_point last = due;
+        while (due <= now && steps < maxSubsteps) {
+            engine.update(step);
+            last = due;
+            due += stepDuration;
+            ++steps;
+        }
+        if (due <= now) {
+            // Too far behind to catch up: drop the backlog.
+            due = now + stepDuration;
+        }
+        publish(last);
+    }
+}
+
+void PhysicsThread::publish(Clock::time_point due) {
+    PhysicsFrame& frame = frames.writeBuffer();
+    const BodyStorage& bodies = engine.getBodies();
+    uint32_t count = bodies.size();
+    frame.previous.resize(count);
+    frame.current.resize(count);
+    frame.handles.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        frame.previous[i] = bodies.previousPosition(i);
+        frame.current[i] = bodies.position(i);
+        frame.handles[i] = bodies.handleAt(i);
+    }
+    frame.step = engine.getStepCount();
+    frame.time = due;
+    frames.publish();
+}
+
+const PhysicsFrame& PhysicsThread::acquireFrame() {
+    frames.update();
+    return frames.readBuffer();
+}
+
+void PhysicsThread::getInterpolatedPositions(std::vector<glm::vec3>& positions) {
+    const PhysicsFrame& frame = acquireFrame();
+    float alpha = std::chrono::duration<float>(Clock::now() - frame.time).count() / step;
+    alpha = std::min(std::max(alpha, 0.0f), 1.0f);
+    size_t count = frame.current.size();
+    positions.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        positions[i] = glm::mix(frame.previous[i], frame.current[i], alpha);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "TripleBuffer.h"
+#include "physics/PhysicsEngine.h"
+
+// Body transforms published after a batch of physics steps, in packed order.
+struct PhysicsFrame {
+    std::vector<glm::vec3> previous; // before the last step
+    std::vector<glm::vec3> current;
+    std::vector<BodyHandle> handles; // body at each packed index
+    uint64_t step = 0;
+    // When the last step was due; the renderer shows previous at this time
+    // and current one step later.
+    std::chrono::steady_clock::time_point time;
+};
+
+// Steps a PhysicsEngine at a fixed rate on a thread of its own and publishes
+// a PhysicsFrame after every batch through a triple buffer, so the render
+// thread reads transforms without locking and a slow step never holds up a
+// frame or the other way round. Rendering runs one step behind and blends
+// the two latest states by wall-clock time.
+//
+// While running, the engine belongs to the physics thread: anything else
+// has to go through post().
+class PhysicsThread {
+public:
+    using Command = std::function<void(PhysicsEngine&)>;
+
+    explicit PhysicsThread(PhysicsEngine& engine);
+    ~PhysicsThread();
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    // Both only while stopped.
+    void setRate(float stepsPerSecond);
+    // Cap on steps run back to back when the thread falls behind; the rest
+    // of the backlog is dropped, as with FixedTimestep.
+    void setMaxSubsteps(int maxSubsteps);
+
+    void start();
+    // Waits for the current step and runs any commands still queued.
+    void stop();
+    bool isRunning() const;
+
+    // Runs command on the physics thread before its next step.
+    void post(Command command);
+
+    // Render thread only. Switches to the newest frame, if any, and blends
+    // it for the current time.
+    const PhysicsFrame& acquireFrame();
+    void getInterpolatedPositions(std::vector<glm::vec3>& positions);
+
+private:
+    void run();
+    void runCommands();
+    void publish(std::chrono::steady_clock::time_point due);
+
+    PhysicsEngine& engine;
+    TripleBuffer<PhysicsFrame> frames;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Command> commands;
+    std::vector<Command> pendingCommands;
+    std::chrono::steady_clock::duration stepDuration;
+    float step;
+    int maxSubsteps;
+};
+
+#endif // PHYSICS_THREAD_H
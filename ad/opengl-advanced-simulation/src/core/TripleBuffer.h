@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one writer thread to one reader thread without locks.
+// Each side owns one of three buffers and the third sits in the middle; the
+// writer publishes by swapping its buffer with the middle one, the reader
+// picks up the newest by doing the same. Neither side ever waits for the
+// other, and the reader skips any values published while it was busy.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : state(1), writeIndex(0), readIndex(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side: fill this, then publish it.
+    T& writeBuffer() { return buffers[writeIndex]; }
+
+    void publish() {
+        uint8_t previous = state.exchange(static_cast<uint8_t>(writeIndex | freshBit), std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    // Reader side: switches to the newest published value, if there is one
+    // the reader hasn't seen. Returns whether it did.
+    bool update() {
+        if ((state.load(std::memory_order_relaxed) & freshBit) == 0) {
+            return false;
+        }
+        uint8_t previous = state.exchange(static_cast<uint8_t>(readIndex), std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    const T& readBuffer() const { return buffers[readIndex]; }
+
+private:
+    static constexpr uint8_t indexMask = 3;
+    static constexpr uint8_t freshBit = 4;
+
+    T buffers[3];
+    std::atomic<uint8_t> state; // middle buffer index, plus freshBit once published
+    uint8_t writeIndex;
+    uint8_t readIndex;
+};
+
+#endif // TRIPLE_BUFFER_H
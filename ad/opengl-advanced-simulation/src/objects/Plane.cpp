@@ -1,28 +1,30 @@
 #include "Plane.h"
-#include <glad/glad.h>
+#include "physics/Cloth.h"
 #include <glm/glm.hpp>
 #include <vector>
 
-Plane::Plane(float width, float height, unsigned int textureID) 
-    : width(width), height(height), textureID(textureID) {
-    setupPlane();
+Plane::Plane(float width, float depth, unsigned int rows, unsigned int cols)
+    : width(width), depth(depth), rows(rows), cols(cols) {
+    setupMesh();
 }
 
-void Plane::setupPlane() {
-    float halfWidth = width / 2.0f;
-    float halfHeight = height / 2.0f;
+void Plane::setupMesh() {
+    // Same vertex order as Cloth, so its output can be copied straight in.
+    for (unsigned int r = 0; r <= rows; ++r) {
+        for (unsigned int c = 0; c <= cols; ++c) {
+            float x = -0.5f * width + width * c / cols;
+            float z = -0.5f * depth + depth * r / rows;
+            vertices.insert(vertices.end(), { x, 0.0f, z, 0.0f, 1.0f, 0.0f });
+        }
+    }
 
-    std::vector<glm::vec3> vertices = {
-        { -halfWidth, 0.0f, -halfHeight },
-        { halfWidth, 0.0f, -halfHeight },
-        { halfWidth, 0.0f, halfHeight },
-        { -halfWidth, 0.0f, halfHeight }
-    };
-
-    std::vector<unsigned int> indices = {
-        0, 1, 2,
-        0, 2, 3
-    };
+    for (unsigned int r = 0; r < rows; ++r) {
+        for (unsigned int c = 0; c < cols; ++c) {
+            unsigned int i = r * (cols + 1) + c;
+            indices.insert(indices.end(), { i, i + cols + 1, i + 1 });
+            indices.insert(indices.end(), { i + 1, i + cols + 1, i + cols + 2 });
+        }
+    }
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -31,23 +33,39 @@ void Plane::setupPlane() {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
+void Plane::update(const Cloth& cloth) {
+    if (cloth.getRows() != rows || cloth.getCols() != cols) {
+        return;
+    }
+    cloth.writeVertices(vertices.data());
+
+    // Orphan the old storage first so the driver can hand out fresh memory
+    // instead of waiting for draws still reading last frame's vertices.
+    GLsizeiptr size = vertices.size() * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void Plane::draw(Shader& shader) {
     shader.use();
     glBindVertexArray(VAO);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
 
@@ -55,4 +73,4 @@ Plane::~Plane() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-}
\ No newline at end of file
+}
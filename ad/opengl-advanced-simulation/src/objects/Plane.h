@@ -5,10 +5,19 @@
 #include <GL/glew.h>
 #include "Shader.h"
 
+class Cloth;
+
+// Grid of rows x cols quads in the xz plane, centred on the origin, with a
+// position and a normal per vertex. The vertex buffer is dynamic so a Cloth
+// of the same size can drive it.
 class Plane {
 public:
     Plane(float width, float depth, unsigned int rows, unsigned int cols);
+    ~Plane();
     void draw(Shader& shader);
+    // Streams the cloth's current vertices into the buffer; the cloth needs
+    // the same rows and cols.
+    void update(const Cloth& cloth);
 
 private:
     void setupMesh();
@@ -17,8 +26,9 @@ private:
     float depth;
     unsigned int rows;
     unsigned int cols;
-    GLuint VAO, VBO;
+    GLuint VAO, VBO, EBO;
     std::vector<float> vertices;
+    std::vector<unsigned int> indices;
 };
 
-#endif // PLANE_H
\ No newline at end of file
+#endif // PLANE_H
@@ -0,0 +1,37 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    AABB() : min(0.0f), max(0.0f) {}
+    AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    static AABB fromSphere(const glm::vec3& center, float radius) {
+        return AABB(center - glm::vec3(radius), center + glm::vec3(radius));
+    }
+
+    bool overlaps(const AABB& other) const {
+        return min.x <= other.max.x && max.x >= other.min.x &&
+               min.y <= other.max.y && max.y >= other.min.y &&
+               min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    bool contains(const AABB& other) const {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+
+    AABB merged(const AABB& other) const {
+        return AABB(glm::min(min, other.min), glm::max(max, other.max));
+    }
+
+    glm::vec3 extents() const {
+        return max - min;
+    }
+};
+
+#endif // AABB_H
@@ -0,0 +1,245 @@
+#include "BarnesHutTree.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+static const uint32_t sourcesPerJob = 4096;
+// Cells with this few sources are summed directly.
+static const uint32_t leafSize = 8;
+// 21 bits per axis fill a 63-bit Morton code.
+static const uint32_t maxLevel = 21;
+// Subtrees below this depth are built in parallel, up to 64 of them.
+static const uint32_t parallelLevel = 2;
+
+// Spreads the low 21 bits of v so that two zero bits follow each one.
+static uint64_t spreadBits(uint64_t v) {
+    v &= 0x1fffffull;
+    v = (v | (v << 32)) & 0x001f00000000ffffull;
+    v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+    v = (v | (v << 8)) & 0x100f00f00f00f00full;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+BarnesHutTree::BarnesHutTree() : theta(0.5f), jobSystem(nullptr) {}
+
+void BarnesHutTree::setTheta(float newTheta) {
+    theta = std::max(newTheta, 0.0f);
+}
+
+float BarnesHutTree::getTheta() const {
+    return theta;
+}
+
+void BarnesHutTree::setJobSystem(JobSystem* jobs) {
+    jobSystem = jobs;
+}
+
+uint32_t BarnesHutTree::getSourceCount() const {
+    return static_cast<uint32_t>(sourceIds.size());
+}
+
+uint32_t BarnesHutTree::getNodeCount() const {
+    return static_cast<uint32_t>(nodes.size());
+}
+
+uint32_t BarnesHutTree::octant(uint32_t source, uint32_t level) const {
+    return static_cast<uint32_t>(keys[source] >> (3 * (maxLevel - 1 - level))) & 7u;
+}
+
+void BarnesHutTree::build(const float* x, const float* y, const float* z, const float* mass, uint32_t count) {
+    nodes.clear();
+    sourceIds.clear();
+    glm::vec3 low(INFINITY), high(-INFINITY);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (mass[i] > 0.0f) {
+            sourceIds.push_back(i);
+            low = glm::min(low, glm::vec3(x[i], y[i], z[i]));
+            high = glm::max(high, glm::vec3(x[i], y[i], z[i]));
+        }
+    }
+    uint32_t sources = static_cast<uint32_t>(sourceIds.size());
+    if (sources == 0) {
+        return;
+    }
+
+    // A cube around every source, so all cells are cubes too.
+    float size = std::max(std::max(high.x - low.x, high.y - low.y), std::max(high.z - low.z, 1e-6f)) * 1.0001f;
+    float scale = static_cast<float>((1u << maxLevel) - 1) / size;
+    std::vector<std::pair<uint64_t, uint32_t>> sorted(sources);
+    parallelFor(jobSystem, sources, sourcesPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; ++k) {
+            uint32_t i = sourceIds[k];
+            glm::vec3 cell = (glm::vec3(x[i], y[i], z[i]) - low) * scale;
+            uint64_t code = spreadBits(static_cast<uint64_t>(cell.x)) << 2 |
+                            spreadBits(static_cast<uint64_t>(cell.y)) << 1 |
+                            spreadBits(static_cast<uint64_t>(cell.z));
+            sorted[k] = { code, i };
+        }
+    });
+    std::sort(sorted.begin(), sorted.end());
+
+    keys.resize(sources);
+    sourceX.resize(sources);
+    sourceY.resize(sources);
+    sourceZ.resize(sources);
+    sourceMass.resize(sources);
+    parallelFor(jobSystem, sources, sourcesPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; ++k) {
+            uint32_t i = sorted[k].second;
+            keys[k] = sorted[k].first;
+            sourceIds[k] = i;
+            sourceX[k] = x[i];
+            sourceY[k] = y[i];
+            sourceZ[k] = z[i];
+            sourceMass[k] = mass[i];
+        }
+    });
+
+    // Top levels here, deeper subtrees into their own node lists in parallel,
+    // then spliced in behind the top in task order.
+    nodes.push_back({ glm::vec3(0.0f), 0.0f, size, 0, 0, 0, sources });
+    std::vector<uint32_t> deferred;
+    buildNode(nodes, 0, 0, &deferred);
+    uint32_t topCount = static_cast<uint32_t>(nodes.size());
+
+    std::vector<std::vector<Node>> subtrees(deferred.size());
+    parallelFor(jobSystem, static_cast<uint32_t>(deferred.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t t = begin; t < end; ++t) {
+            subtrees[t].assign(1, nodes[deferred[t]]);
+            buildNode(subtrees[t], 0, parallelLevel, nullptr);
+        }
+    });
+    for (size_t t = 0; t < subtrees.size(); ++t) {
+        // Local node k > 0 lands at offset + k.
+        uint32_t offset = static_cast<uint32_t>(nodes.size()) - 1;
+        for (Node& node : subtrees[t]) {
+            if (node.childCount > 0) {
+                node.firstChild += offset;
+            }
+        }
+        nodes[deferred[t]] = subtrees[t][0];
+        nodes.insert(nodes.end(), subtrees[t].begin() + 1, subtrees[t].end());
+    }
+
+    // Children always come after their parent, so walking the top backwards
+    // sees every child finished before the parent is combined.
+    for (uint32_t index = topCount; index-- > 0;) {
+        if (nodes[index].childCount > 0) {
+            combineChildren(nodes, index);
+        }
+    }
+}
+
+void BarnesHutTree::computeLeaf(Node& node) const {
+    node.mass = 0.0f;
+    glm::vec3 weighted(0.0f);
+    for (uint32_t k = node.begin; k < node.end; ++k) {
+        node.mass += sourceMass[k];
+        weighted += sourceMass[k] * glm::vec3(sourceX[k], sourceY[k], sourceZ[k]);
+    }
+    node.centerOfMass = weighted / node.mass;
+}
+
+void BarnesHutTree::combineChildren(std::vector<Node>& out, uint32_t index) {
+    Node& node = out[index];
+    node.mass = 0.0f;
+    glm::vec3 weighted(0.0f);
+    for (uint32_t c = 0; c < node.childCount; ++c) {
+        const Node& child = out[node.firstChild + c];
+        node.mass += child.mass;
+        weighted += child.mass * child.centerOfMass;
+    }
+    node.centerOfMass = weighted / node.mass;
+}
+
+void BarnesHutTree::buildNode(std::vector<Node>& out, uint32_t index, uint32_t level,
+                              std::vector<uint32_t>* deferred) const {
+    uint32_t begin = out[index].begin;
+    uint32_t end = out[index].end;
+    if (end - begin <= leafSize || level == maxLevel) {
+        computeLeaf(out[index]);
+        return;
+    }
+    if (deferred && level == parallelLevel) {
+        deferred->push_back(index);
+        return;
+    }
+
+    // Sources are sorted by Morton code, so each octant is a contiguous run
+    // and the runs come in octant order.
+    uint32_t first = static_cast<uint32_t>(out.size());
+    float childSize = 0.5f * out[index].size;
+    for (uint32_t start = begin; start < end;) {
+        uint32_t child = octant(start, level);
+        uint32_t stop = start + 1;
+        uint32_t limit = end;
+        while (stop < limit) {
+            uint32_t middle = stop + (limit - stop) / 2;
+            if (octant(middle, level) == child) {
+                stop = middle + 1;
+            } else {
+                limit = middle;
+            }
+        }
+        out.push_back({ glm::vec3(0.0f), 0.0f, childSize, 0, 0, start, stop });
+        start = stop;
+    }
+    out[index].firstChild = first;
+    out[index].childCount = static_cast<uint32_t>(out.size()) - first;
+
+    for (uint32_t c = first; c < first + out[index].childCount; ++c) {
+        buildNode(out, c, level + 1, deferred);
+    }
+    if (!deferred) {
+        combineChildren(out, index);
+    }
+}
+
+glm::vec3 BarnesHutTree::field(const glm::vec3& point, float softening, uint32_t skip) const {
+    glm::vec3 total(0.0f);
+    if (nodes.empty()) {
+        return total;
+    }
+    float softening2 = softening * softening;
+    float theta2 = theta * theta;
+
+    // Depth is at most maxLevel and each level adds at most 7 entries.
+    uint32_t stack[8 * (maxLevel + 1)];
+    uint32_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        glm::vec3 delta = node.centerOfMass - point;
+        float distance2 = glm::dot(delta, delta);
+        if (node.childCount == 0) {
+            for (uint32_t k = node.begin; k < node.end; ++k) {
+                if (sourceIds[k] == skip) {
+                    continue;
+                }
+                glm::vec3 d(sourceX[k] - point.x, sourceY[k] - point.y, sourceZ[k] - point.z);
+                float r2 = glm::dot(d, d) + softening2;
+                total += d * (sourceMass[k] / (r2 * std::sqrt(r2)));
+            }
+        } else if (node.size * node.size < theta2 * distance2) {
+            float r2 = distance2 + softening2;
+            total += delta * (node.mass / (r2 * std::sqrt(r2)));
+        } else {
+            for (uint32_t c = 0; c < node.childCount; ++c) {
+                stack[top++] = node.firstChild + c;
+            }
+        }
+    }
+    return total;
+}
+
+void BarnesHutTree::computeFields(float softening, uint32_t count, std::vector<glm::vec3>& fields) const {
+    fields.assign(count, glm::vec3(0.0f));
+    parallelFor(jobSystem, getSourceCount(), sourcesPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; ++k) {
+            fields[sourceIds[k]] = field(glm::vec3(sourceX[k], sourceY[k], sourceZ[k]), softening, sourceIds[k]);
+        }
+    });
+}
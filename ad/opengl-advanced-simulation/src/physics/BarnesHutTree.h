@@ -0,0 +1,71 @@
+#ifndef BARNES_HUT_TREE_H
+#define BARNES_HUT_TREE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+// Octree over point masses for long-range inverse-square forces. Each node
+// keeps the total mass and centre of mass of everything below it; a node
+// whose cell is smaller than theta times its distance from the query point
+// is treated as a single mass, so a query visits O(log n) nodes instead of
+// every source.
+//
+// The tree is rebuilt from scratch every time: sources are sorted by Morton
+// code, which makes each cell a contiguous range, the top two levels are
+// split on the calling thread and the subtrees below them are built in
+// parallel. Node order, and so every result, doesn't depend on the number
+// of threads.
+class BarnesHutTree {
+public:
+    BarnesHutTree();
+
+    // Opening angle: 0 is exact but O(n) per query, around 0.5 is the usual
+    // trade-off and larger values get faster and less accurate.
+    void setTheta(float theta);
+    float getTheta() const;
+    void setJobSystem(JobSystem* jobs);
+
+    // Sources with zero mass are left out.
+    void build(const float* x, const float* y, const float* z, const float* mass, uint32_t count);
+
+    // Sum over sources j other than skip of
+    //   m_j (p_j - point) / (|p_j - point|^2 + softening^2)^(3/2),
+    // i.e. the acceleration towards the sources for unit strength.
+    glm::vec3 field(const glm::vec3& point, float softening, uint32_t skip) const;
+
+    // field() at every source, skipping itself, stored at fields[source id]
+    // (resized to count). Sources are walked in Morton order so neighbouring
+    // queries reuse the same nodes from cache; other entries are zeroed.
+    void computeFields(float softening, uint32_t count, std::vector<glm::vec3>& fields) const;
+
+    uint32_t getSourceCount() const;
+    uint32_t getNodeCount() const;
+
+private:
+    struct Node {
+        glm::vec3 centerOfMass;
+        float mass;
+        float size;          // edge length of the cubic cell
+        uint32_t firstChild; // children are stored next to each other
+        uint32_t childCount; // 0 for leaves
+        uint32_t begin;      // range of sorted sources in the cell
+        uint32_t end;
+    };
+
+    void buildNode(std::vector<Node>& out, uint32_t index, uint32_t level, std::vector<uint32_t>* deferred) const;
+    void computeLeaf(Node& node) const;
+    static void combineChildren(std::vector<Node>& out, uint32_t index);
+    uint32_t octant(uint32_t source, uint32_t level) const;
+
+    float theta;
+    JobSystem* jobSystem;
+    std::vector<uint64_t> keys;     // Morton code per sorted source
+    std::vector<uint32_t> sourceIds;
+    std::vector<float> sourceX, sourceY, sourceZ, sourceMass;
+    std::vector<Node> nodes;
+};
+
+#endif // BARNES_HUT_TREE_H
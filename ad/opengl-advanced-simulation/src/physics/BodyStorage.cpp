@@ -0,0 +1,233 @@
+#include "BodyStorage.h"
+#include <utility>
+
+BodyHandle BodyStorage::create(const RigidBody& body) {
+    uint32_t slotIndex;
+    if (freeSlot != invalidIndex) {
+        slotIndex = freeSlot;
+        freeSlot = slots[slotIndex].dense;
+    } else {
+        slotIndex = static_cast<uint32_t>(slots.size());
+        slots.push_back({ invalidIndex, 0 });
+    }
+
+    uint32_t dense = size();
+    slots[slotIndex].dense = dense;
+    denseToSlot.push_back(slotIndex);
+
+    glm::vec3 p = body.getPosition();
+    glm::vec3 v = body.getVelocity();
+    positionX.push_back(p.x);
+    positionY.push_back(p.y);
+    positionZ.push_back(p.z);
+    previousX.push_back(p.x);
+    previousY.push_back(p.y);
+    previousZ.push_back(p.z);
+    velocityX.push_back(v.x);
+    velocityY.push_back(v.y);
+    velocityZ.push_back(v.z);
+    forceX.push_back(0.0f);
+    forceY.push_back(0.0f);
+    forceZ.push_back(0.0f);
+    // Planes are infinite, so they can only ever be static.
+    bool dynamic = body.getMass() > 0.0f && body.getCollider().getType() != ColliderType::Plane;
+    inverseMass.push_back(dynamic ? 1.0f / body.getMass() : 0.0f);
+    radius.push_back(body.getRadius());
+    restitution.push_back(body.getRestitution());
+    friction.push_back(body.getFriction());
+    collider.push_back(body.getCollider());
+
+    // New bodies start awake.
+    swapBodies(dense, awake);
+    ++awake;
+
+    return { slotIndex, slots[slotIndex].generation };
+}
+
+bool BodyStorage::destroy(BodyHandle handle) {
+    if (!isValid(handle)) {
+        return false;
+    }
+
+    // Step out of the awake range first so the swap from the back below
+    // only ever moves a sleeping body.
+    sleep(handle);
+    swapRemove(slots[handle.index].dense);
+
+    Slot& slot = slots[handle.index];
+    ++slot.generation;
+    slot.dense = freeSlot;
+    freeSlot = handle.index;
+    return true;
+}
+
+void BodyStorage::wake(BodyHandle handle) {
+    uint32_t index = slots[handle.index].dense;
+    if (index >= awake) {
+        swapBodies(index, awake);
+        ++awake;
+    }
+}
+
+void BodyStorage::sleep(BodyHandle handle) {
+    uint32_t index = slots[handle.index].dense;
+    if (index < awake) {
+        --awake;
+        swapBodies(index, awake);
+    }
+}
+
+void BodyStorage::swapBodies(uint32_t i, uint32_t j) {
+    if (i == j) {
+        return;
+    }
+    std::swap(positionX[i], positionX[j]);
+    std::swap(positionY[i], positionY[j]);
+    std::swap(positionZ[i], positionZ[j]);
+    std::swap(previousX[i], previousX[j]);
+    std::swap(previousY[i], previousY[j]);
+    std::swap(previousZ[i], previousZ[j]);
+    std::swap(velocityX[i], velocityX[j]);
+    std::swap(velocityY[i], velocityY[j]);
+    std::swap(velocityZ[i], velocityZ[j]);
+    std::swap(forceX[i], forceX[j]);
+    std::swap(forceY[i], forceY[j]);
+    std::swap(forceZ[i], forceZ[j]);
+    std::swap(inverseMass[i], inverseMass[j]);
+    std::swap(radius[i], radius[j]);
+    std::swap(restitution[i], restitution[j]);
+    std::swap(friction[i], friction[j]);
+    std::swap(collider[i], collider[j]);
+    std::swap(denseToSlot[i], denseToSlot[j]);
+    slots[denseToSlot[i]].dense = i;
+    slots[denseToSlot[j]].dense = j;
+}
+
+template <typename T>
+static void gather(std::vector<T>& column, const std::vector<uint32_t>& order) {
+    std::vector<T> moved(column.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        moved[i] = column[order[i]];
+    }
+    column.swap(moved);
+}
+
+void BodyStorage::permute(const std::vector<uint32_t>& order) {
+    for (std::vector<float>* column : { &positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ,
+                                        &velocityX, &velocityY, &velocityZ, &forceX, &forceY, &forceZ,
+                                        &inverseMass, &radius, &restitution, &friction }) {
+        gather(*column, order);
+    }
+    gather(collider, order);
+    gather(denseToSlot, order);
+    for (uint32_t i = 0; i < size(); ++i) {
+        slots[denseToSlot[i]].dense = i;
+    }
+}
+
+void BodyStorage::swapRemove(uint32_t index) {
+    swapBodies(index, size() - 1);
+
+    positionX.pop_back();
+    positionY.pop_back();
+    positionZ.pop_back();
+    previousX.pop_back();
+    previousY.pop_back();
+    previousZ.pop_back();
+    velocityX.pop_back();
+    velocityY.pop_back();
+    velocityZ.pop_back();
+    forceX.pop_back();
+    forceY.pop_back();
+    forceZ.pop_back();
+    inverseMass.pop_back();
+    radius.pop_back();
+    restitution.pop_back();
+    friction.pop_back();
+    collider.pop_back();
+    denseToSlot.pop_back();
+}
+
+void BodyStorage::clear() {
+    while (size() > 0) {
+        destroy(handleAt(size() - 1));
+    }
+}
+
+bool BodyStorage::isValid(BodyHandle handle) const {
+    return handle.index < slots.size() &&
+           slots[handle.index].generation == handle.generation &&
+           slots[handle.index].dense < size() &&
+           denseToSlot[slots[handle.index].dense] == handle.index;
+}
+
+uint32_t BodyStorage::denseIndex(BodyHandle handle) const {
+    return slots[handle.index].dense;
+}
+
+BodyHandle BodyStorage::handleAt(uint32_t denseIndex) const {
+    uint32_t slotIndex = denseToSlot[denseIndex];
+    return { slotIndex, slots[slotIndex].generation };
+}
+
+BodyHandle BodyStorage::handleForSlot(uint32_t slotIndex) const {
+    return { slotIndex, slots[slotIndex].generation };
+}
+
+uint32_t BodyStorage::size() const {
+    return static_cast<uint32_t>(denseToSlot.size());
+}
+
+void BodyStorage::save(SnapshotWriter& out) const {
+    for (const std::vector<float>* column : { &positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ,
+                                              &velocityX, &velocityY, &velocityZ, &forceX, &forceY, &forceZ,
+                                              &inverseMass, &radius, &restitution, &friction }) {
+        out.writeVector(*column);
+    }
+    for (const Collider& shape : collider) {
+        shape.save(out);
+    }
+    out.writeVector(slots);
+    out.writeVector(denseToSlot);
+    out.write(freeSlot);
+    out.write(awake);
+}
+
+bool BodyStorage::load(SnapshotReader& in) {
+    std::vector<float>* const columns[] = { &positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ,
+                                            &velocityX, &velocityY, &velocityZ, &forceX, &forceY, &forceZ,
+                                            &inverseMass, &radius, &restitution, &friction };
+    for (std::vector<float>* column : columns) {
+        in.readVector(*column);
+    }
+    size_t count = positionX.size();
+    collider.clear();
+    for (size_t i = 0; i < count && in.ok(); ++i) {
+        collider.push_back(Collider::load(in));
+    }
+    in.readVector(slots);
+    in.readVector(denseToSlot);
+    in.read(freeSlot);
+    in.read(awake);
+
+    bool consistent = in.ok() && denseToSlot.size() == count && collider.size() == count && awake <= count;
+    for (const std::vector<float>* column : columns) {
+        consistent = consistent && column->size() == count;
+    }
+    // Every live slot has to point back at the packed index that names it.
+    for (size_t i = 0; consistent && i < count; ++i) {
+        uint32_t slot = denseToSlot[i];
+        consistent = slot < slots.size() && slots[slot].dense == i;
+    }
+    // The free list may only run through dead slots, and must end.
+    uint32_t free = freeSlot;
+    for (size_t steps = 0; consistent && free != invalidIndex; ++steps) {
+        consistent = free < slots.size() && steps < slots.size() &&
+                     !(slots[free].dense < count && denseToSlot[slots[free].dense] == free);
+        free = consistent ? slots[free].dense : invalidIndex;
+    }
+    if (!consistent) {
+        *this = BodyStorage();
+    }
+    return consistent;
+}
@@ -0,0 +1,93 @@
+#ifndef BODY_STORAGE_H
+#define BODY_STORAGE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "RigidBody.h"
+#include "Snapshot.h"
+
+// Stable reference to a body. The generation changes every time a slot is
+// reused, so a handle to a removed body never aliases a newer one.
+struct BodyHandle {
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==(const BodyHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const BodyHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+// Structure-of-arrays body data. Live bodies are packed at the front of every
+// column, removal swaps the last body into the hole, and handles are mapped to
+// the packed index through a slot table. Awake bodies come first, so stepping
+// only has to walk [0, awakeCount()).
+class BodyStorage {
+public:
+    BodyHandle create(const RigidBody& body);
+    // Returns false if the handle was stale.
+    bool destroy(BodyHandle handle);
+    void clear();
+
+    bool isValid(BodyHandle handle) const;
+    uint32_t denseIndex(BodyHandle handle) const;
+    BodyHandle handleAt(uint32_t denseIndex) const;
+    BodyHandle handleForSlot(uint32_t slotIndex) const;
+    uint32_t size() const;
+    // Live and free handle slots; every handle index is below this.
+    uint32_t slotCount() const { return static_cast<uint32_t>(slots.size()); }
+
+    uint32_t awakeCount() const { return awake; }
+    bool isAwake(uint32_t denseIndex) const { return denseIndex < awake; }
+    // Move a body across the awake/asleep boundary. Both change the packed
+    // index of the body and of the one it swaps with.
+    void wake(BodyHandle handle);
+    void sleep(BodyHandle handle);
+    // Moves the body at packed index order[i] to i for every i. Handles stay
+    // valid; order must keep awake bodies in [0, awakeCount()).
+    void permute(const std::vector<uint32_t>& order);
+
+    // Everything, including the slot table, so saved handles stay valid.
+    void save(SnapshotWriter& out) const;
+    bool load(SnapshotReader& in);
+
+    glm::vec3 position(uint32_t i) const { return glm::vec3(positionX[i], positionY[i], positionZ[i]); }
+    glm::vec3 previousPosition(uint32_t i) const { return glm::vec3(previousX[i], previousY[i], previousZ[i]); }
+    glm::vec3 velocity(uint32_t i) const { return glm::vec3(velocityX[i], velocityY[i], velocityZ[i]); }
+    glm::vec3 force(uint32_t i) const { return glm::vec3(forceX[i], forceY[i], forceZ[i]); }
+    void setPosition(uint32_t i, const glm::vec3& p) { positionX[i] = p.x; positionY[i] = p.y; positionZ[i] = p.z; }
+    void setPreviousPosition(uint32_t i, const glm::vec3& p) { previousX[i] = p.x; previousY[i] = p.y; previousZ[i] = p.z; }
+    void setVelocity(uint32_t i, const glm::vec3& v) { velocityX[i] = v.x; velocityY[i] = v.y; velocityZ[i] = v.z; }
+    void addForce(uint32_t i, const glm::vec3& f) { forceX[i] += f.x; forceY[i] += f.y; forceZ[i] += f.z; }
+
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> previousX, previousY, previousZ; // position before the last step
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> forceX, forceY, forceZ;
+    std::vector<float> inverseMass;
+    std::vector<float> radius; // bounding radius for non-sphere colliders
+    std::vector<float> restitution;
+    std::vector<float> friction;
+    std::vector<Collider> collider;
+
+private:
+    struct Slot {
+        uint32_t dense;     // packed index while alive, next free slot otherwise
+        uint32_t generation;
+    };
+
+    void swapBodies(uint32_t i, uint32_t j);
+    void swapRemove(uint32_t denseIndex);
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> denseToSlot;
+    uint32_t freeSlot = invalidIndex;
+    uint32_t awake = 0;
+
+    static constexpr uint32_t invalidIndex = 0xffffffffu;
+};
+
+#endif // BODY_STORAGE_H
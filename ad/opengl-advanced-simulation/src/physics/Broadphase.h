@@ -0,0 +1,41 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <cstdint>
+#include <vector>
+#include "AABB.h"
+
+class JobSystem;
+
+// Candidate pair of body indices, always stored with a < b.
+struct BroadphasePair {
+    uint32_t a;
+    uint32_t b;
+};
+
+enum class BroadphaseType {
+    SpatialHash,
+    SweepAndPrune
+};
+
+class Broadphase {
+public:
+    virtual ~Broadphase() = default;
+
+    // bounds[i] is the box of body i; pairs is overwritten with every
+    // overlapping pair of boxes.
+    virtual void findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) = 0;
+
+    // Called when bodies are added or removed so that implementations which
+    // keep state between frames drop anything indexed by the old layout.
+    virtual void invalidate() {}
+
+    // Optional pool for implementations that can split their work; null runs
+    // everything on the calling thread.
+    virtual void setJobSystem(JobSystem* jobs) { jobSystem = jobs; }
+
+protected:
+    JobSystem* jobSystem = nullptr;
+};
+
+#endif // BROADPHASE_H
@@ -0,0 +1,443 @@
+#include "Cloth.h"
+#include "Simd.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+// Vertices and constraints per job; a multiple of 8 for the SIMD kernels.
+static const uint32_t verticesPerJob = 4096;
+static const uint32_t constraintsPerJob = 2048;
+// Cloth keeps this far from colliders so it doesn't visibly clip them.
+static const float collisionMargin = 0.01f;
+
+namespace {
+
+// Position in xyz and inverse mass in w, so one 16-byte load brings in
+// everything a constraint needs from a vertex.
+typedef glm::vec4 Particle;
+
+void projectScalar(Particle* p, const uint32_t* first, const uint32_t* second, const float* restLength,
+                   uint32_t begin, uint32_t end, float alpha) {
+    for (uint32_t k = begin; k < end; ++k) {
+        Particle& a = p[first[k]];
+        Particle& b = p[second[k]];
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float dz = b.z - a.z;
+        float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+        float denominator = (a.w + b.w + alpha) * length;
+        if (!(denominator > 1e-12f)) {
+            continue;
+        }
+        float correction = (length - restLength[k]) / denominator;
+        a.x += a.w * correction * dx;
+        a.y += a.w * correction * dy;
+        a.z += a.w * correction * dz;
+        b.x -= b.w * correction * dx;
+        b.y -= b.w * correction * dy;
+        b.z -= b.w * correction * dz;
+    }
+}
+
+#ifdef PHYSICS_SIMD_X86
+
+// Constraints in a color touch disjoint vertices, so each lane loads and
+// stores its own two particles; a 4x4 transpose turns them into x, y, z and
+// w registers and back.
+PHYSICS_TARGET_SSE2 uint32_t projectSSE(Particle* p, const uint32_t* first, const uint32_t* second,
+                                        const float* restLength, uint32_t begin, uint32_t end, float alpha) {
+    uint32_t last = begin + ((end - begin) & ~3u);
+    __m128 alphaV = _mm_set1_ps(alpha);
+    __m128 epsilon = _mm_set1_ps(1e-12f);
+    for (uint32_t k = begin; k < last; k += 4) {
+        float* a[4];
+        float* b[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            a[lane] = &p[first[k + lane]].x;
+            b[lane] = &p[second[k + lane]].x;
+        }
+        __m128 ax = _mm_loadu_ps(a[0]), ay = _mm_loadu_ps(a[1]), az = _mm_loadu_ps(a[2]), wA = _mm_loadu_ps(a[3]);
+        __m128 bx = _mm_loadu_ps(b[0]), by = _mm_loadu_ps(b[1]), bz = _mm_loadu_ps(b[2]), wB = _mm_loadu_ps(b[3]);
+        _MM_TRANSPOSE4_PS(ax, ay, az, wA);
+        _MM_TRANSPOSE4_PS(bx, by, bz, wB);
+
+        __m128 dx = _mm_sub_ps(bx, ax);
+        __m128 dy = _mm_sub_ps(by, ay);
+        __m128 dz = _mm_sub_ps(bz, az);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 denominator = _mm_mul_ps(_mm_add_ps(_mm_add_ps(wA, wB), alphaV), length);
+        __m128 valid = _mm_cmpgt_ps(denominator, epsilon);
+        __m128 correction = _mm_and_ps(valid, _mm_div_ps(_mm_sub_ps(length, _mm_loadu_ps(restLength + k)),
+                                                         _mm_max_ps(denominator, epsilon)));
+        __m128 moveA = _mm_mul_ps(wA, correction);
+        __m128 moveB = _mm_mul_ps(wB, correction);
+        ax = _mm_add_ps(ax, _mm_mul_ps(moveA, dx));
+        ay = _mm_add_ps(ay, _mm_mul_ps(moveA, dy));
+        az = _mm_add_ps(az, _mm_mul_ps(moveA, dz));
+        bx = _mm_sub_ps(bx, _mm_mul_ps(moveB, dx));
+        by = _mm_sub_ps(by, _mm_mul_ps(moveB, dy));
+        bz = _mm_sub_ps(bz, _mm_mul_ps(moveB, dz));
+
+        _MM_TRANSPOSE4_PS(ax, ay, az, wA);
+        _MM_TRANSPOSE4_PS(bx, by, bz, wB);
+        _mm_storeu_ps(a[0], ax);
+        _mm_storeu_ps(a[1], ay);
+        _mm_storeu_ps(a[2], az);
+        _mm_storeu_ps(a[3], wA);
+        _mm_storeu_ps(b[0], bx);
+        _mm_storeu_ps(b[1], by);
+        _mm_storeu_ps(b[2], bz);
+        _mm_storeu_ps(b[3], wB);
+    }
+    return last;
+}
+
+// 4x4 transpose of eight particles at once: lanes 0-3 in the low halves,
+// 4-7 in the high halves.
+PHYSICS_TARGET_AVX2 inline void transpose8(float* const* rows, __m256& x, __m256& y, __m256& z, __m256& w) {
+    __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rows[0])), _mm_loadu_ps(rows[4]), 1);
+    __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rows[1])), _mm_loadu_ps(rows[5]), 1);
+    __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rows[2])), _mm_loadu_ps(rows[6]), 1);
+    __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(rows[3])), _mm_loadu_ps(rows[7]), 1);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    w = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+PHYSICS_TARGET_AVX2 inline void storeTransposed8(float* const* rows, __m256 x, __m256 y, __m256 z, __m256 w) {
+    __m256 t0 = _mm256_unpacklo_ps(x, y);
+    __m256 t1 = _mm256_unpacklo_ps(z, w);
+    __m256 t2 = _mm256_unpackhi_ps(x, y);
+    __m256 t3 = _mm256_unpackhi_ps(z, w);
+    __m256 r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm_storeu_ps(rows[0], _mm256_castps256_ps128(r0));
+    _mm_storeu_ps(rows[1], _mm256_castps256_ps128(r1));
+    _mm_storeu_ps(rows[2], _mm256_castps256_ps128(r2));
+    _mm_storeu_ps(rows[3], _mm256_castps256_ps128(r3));
+    _mm_storeu_ps(rows[4], _mm256_extractf128_ps(r0, 1));
+    _mm_storeu_ps(rows[5], _mm256_extractf128_ps(r1, 1));
+    _mm_storeu_ps(rows[6], _mm256_extractf128_ps(r2, 1));
+    _mm_storeu_ps(rows[7], _mm256_extractf128_ps(r3, 1));
+}
+
+PHYSICS_TARGET_AVX2 uint32_t projectAVX2(Particle* p, const uint32_t* first, const uint32_t* second,
+                                         const float* restLength, uint32_t begin, uint32_t end, float alpha) {
+    uint32_t last = begin + ((end - begin) & ~7u);
+    __m256 alphaV = _mm256_set1_ps(alpha);
+    __m256 epsilon = _mm256_set1_ps(1e-12f);
+    for (uint32_t k = begin; k < last; k += 8) {
+        float* a[8];
+        float* b[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            a[lane] = &p[first[k + lane]].x;
+            b[lane] = &p[second[k + lane]].x;
+        }
+        __m256 ax, ay, az, wA, bx, by, bz, wB;
+        transpose8(a, ax, ay, az, wA);
+        transpose8(b, bx, by, bz, wB);
+
+        __m256 dx = _mm256_sub_ps(bx, ax);
+        __m256 dy = _mm256_sub_ps(by, ay);
+        __m256 dz = _mm256_sub_ps(bz, az);
+        __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                                     _mm256_mul_ps(dz, dz)));
+        __m256 denominator = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(wA, wB), alphaV), length);
+        __m256 valid = _mm256_cmp_ps(denominator, epsilon, _CMP_GT_OQ);
+        __m256 rest = _mm256_loadu_ps(restLength + k);
+        __m256 correction = _mm256_and_ps(valid, _mm256_div_ps(_mm256_sub_ps(length, rest), _mm256_max_ps(denominator, epsilon)));
+        __m256 moveA = _mm256_mul_ps(wA, correction);
+        __m256 moveB = _mm256_mul_ps(wB, correction);
+        ax = _mm256_add_ps(ax, _mm256_mul_ps(moveA, dx));
+        ay = _mm256_add_ps(ay, _mm256_mul_ps(moveA, dy));
+        az = _mm256_add_ps(az, _mm256_mul_ps(moveA, dz));
+        bx = _mm256_sub_ps(bx, _mm256_mul_ps(moveB, dx));
+        by = _mm256_sub_ps(by, _mm256_mul_ps(moveB, dy));
+        bz = _mm256_sub_ps(bz, _mm256_mul_ps(moveB, dz));
+
+        storeTransposed8(a, ax, ay, az, wA);
+        storeTransposed8(b, bx, by, bz, wB);
+    }
+    return last;
+}
+
+#endif // PHYSICS_SIMD_X86
+
+} // namespace
+
+Cloth::Cloth(float width, float depth, unsigned int rows, unsigned int cols, const glm::vec3& origin)
+    : rows(std::max(rows, 1u)), cols(std::max(cols, 1u)), jobSystem(nullptr), level(Integrator::detectSimdLevel()),
+      gravity(0.0f, -9.81f, 0.0f), substeps(10), stretchCompliance(0.0f), bendCompliance(1e-4f), damping(0.1f),
+      hasGround(false), groundHeight(0.0f) {
+    uint32_t count = getVertexCount();
+    particles.resize(count);
+    for (unsigned int r = 0; r <= this->rows; ++r) {
+        for (unsigned int c = 0; c <= this->cols; ++c) {
+            particles[vertexIndex(r, c)] = glm::vec4(origin.x - 0.5f * width + width * c / this->cols, origin.y,
+                                                     origin.z - 0.5f * depth + depth * r / this->rows, 1.0f);
+        }
+    }
+    previous.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        previous[i] = glm::vec3(particles[i]);
+    }
+    velocity.assign(count, glm::vec3(0.0f));
+    normals.assign(count, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<uint32_t> stretch;
+    std::vector<uint32_t> bend;
+    for (unsigned int r = 0; r <= this->rows; ++r) {
+        for (unsigned int c = 0; c <= this->cols; ++c) {
+            uint32_t i = vertexIndex(r, c);
+            if (c < this->cols) {
+                stretch.insert(stretch.end(), {i, vertexIndex(r, c + 1)});
+            }
+            if (r < this->rows) {
+                stretch.insert(stretch.end(), {i, vertexIndex(r + 1, c)});
+            }
+            if (r < this->rows && c < this->cols) {
+                // Both diagonals, so the cloth shears the same either way.
+                stretch.insert(stretch.end(), {i, vertexIndex(r + 1, c + 1)});
+                stretch.insert(stretch.end(), {vertexIndex(r, c + 1), vertexIndex(r + 1, c)});
+            }
+            if (c + 1 < this->cols) {
+                bend.insert(bend.end(), {i, vertexIndex(r, c + 2)});
+            }
+            if (r + 1 < this->rows) {
+                bend.insert(bend.end(), {i, vertexIndex(r + 2, c)});
+            }
+        }
+    }
+    colorConstraints(stretch, stretchBatches);
+    colorConstraints(bend, bendBatches);
+}
+
+void Cloth::colorConstraints(const std::vector<uint32_t>& pairs, std::vector<ConstraintBatch>& batches) {
+    // Greedy coloring: each constraint takes the lowest color neither of its
+    // vertices uses yet. A vertex in d constraints never needs more than
+    // 2d - 1 colors, far below 64 for any mesh.
+    std::vector<uint64_t> usedColors(getVertexCount(), 0);
+    for (size_t k = 0; k + 1 < pairs.size(); k += 2) {
+        uint32_t a = pairs[k];
+        uint32_t b = pairs[k + 1];
+        uint64_t used = usedColors[a] | usedColors[b];
+        uint32_t color = 0;
+        while (color < 63 && (used >> color & 1)) {
+            ++color;
+        }
+        usedColors[a] |= 1ull << color;
+        usedColors[b] |= 1ull << color;
+        if (batches.size() <= color) {
+            batches.resize(color + 1);
+        }
+        ConstraintBatch& batch = batches[color];
+        batch.first.push_back(a);
+        batch.second.push_back(b);
+        batch.restLength.push_back(glm::length(getPosition(b) - getPosition(a)));
+    }
+}
+
+unsigned int Cloth::getRows() const {
+    return rows;
+}
+
+unsigned int Cloth::getCols() const {
+    return cols;
+}
+
+uint32_t Cloth::getVertexCount() const {
+    return (rows + 1) * (cols + 1);
+}
+
+uint32_t Cloth::vertexIndex(unsigned int row, unsigned int col) const {
+    return row * (cols + 1) + col;
+}
+
+void Cloth::pin(uint32_t vertex, bool pinned) {
+    particles[vertex].w = pinned ? 0.0f : 1.0f;
+    if (pinned) {
+        velocity[vertex] = glm::vec3(0.0f);
+    }
+}
+
+void Cloth::setPosition(uint32_t vertex, const glm::vec3& position) {
+    particles[vertex] = glm::vec4(position, particles[vertex].w);
+    previous[vertex] = position;
+}
+
+glm::vec3 Cloth::getPosition(uint32_t vertex) const {
+    return glm::vec3(particles[vertex]);
+}
+
+void Cloth::setGravity(const glm::vec3& newGravity) {
+    gravity = newGravity;
+}
+
+void Cloth::setSubsteps(int newSubsteps) {
+    substeps = std::max(newSubsteps, 1);
+}
+
+void Cloth::setStretchCompliance(float compliance) {
+    stretchCompliance = std::max(compliance, 0.0f);
+}
+
+void Cloth::setBendCompliance(float compliance) {
+    bendCompliance = std::max(compliance, 0.0f);
+}
+
+void Cloth::setDamping(float newDamping) {
+    damping = std::max(newDamping, 0.0f);
+}
+
+void Cloth::addSphereCollider(const glm::vec3& center, float radius) {
+    spheres.push_back({ center, radius });
+}
+
+void Cloth::clearColliders() {
+    spheres.clear();
+}
+
+void Cloth::setGround(bool enabled, float height) {
+    hasGround = enabled;
+    groundHeight = height;
+}
+
+void Cloth::setJobSystem(JobSystem* jobs) {
+    jobSystem = jobs;
+}
+
+void Cloth::setSimdLevel(SimdLevel requested) {
+    level = std::min(requested, Integrator::detectSimdLevel());
+}
+
+SimdLevel Cloth::getSimdLevel() const {
+    return level;
+}
+
+void Cloth::projectBatch(const ConstraintBatch& batch, uint32_t begin, uint32_t end, float alpha) {
+    const uint32_t* first = batch.first.data();
+    const uint32_t* second = batch.second.data();
+    const float* restLength = batch.restLength.data();
+    uint32_t done = begin;
+
+#ifdef PHYSICS_SIMD_X86
+    if (level == SimdLevel::AVX2) {
+        done = projectAVX2(particles.data(), first, second, restLength, begin, end, alpha);
+    } else if (level == SimdLevel::SSE) {
+        done = projectSSE(particles.data(), first, second, restLength, begin, end, alpha);
+    }
+#endif
+
+    projectScalar(particles.data(), first, second, restLength, done, end, alpha);
+}
+
+void Cloth::update(float deltaTime) {
+    if (deltaTime <= 0.0f) {
+        return;
+    }
+    uint32_t count = getVertexCount();
+    float h = deltaTime / substeps;
+    // XPBD scales compliance by the squared step so stiffness doesn't
+    // depend on the substep count.
+    float stretchAlpha = stretchCompliance / (h * h);
+    float bendAlpha = bendCompliance / (h * h);
+    float keep = std::max(1.0f - damping * h, 0.0f);
+
+    for (int step = 0; step < substeps; ++step) {
+        parallelFor(jobSystem, count, verticesPerJob, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                glm::vec4& p = particles[i];
+                previous[i] = glm::vec3(p);
+                if (p.w > 0.0f) {
+                    velocity[i] += gravity * h;
+                    p += glm::vec4(velocity[i] * h, 0.0f);
+                }
+            }
+        });
+
+        // Colors run one after another; inside a color nothing is shared.
+        for (const ConstraintBatch& batch : stretchBatches) {
+            parallelFor(jobSystem, static_cast<uint32_t>(batch.first.size()), constraintsPerJob, [&](uint32_t begin, uint32_t end) {
+                projectBatch(batch, begin, end, stretchAlpha);
+            });
+        }
+        for (const ConstraintBatch& batch : bendBatches) {
+            parallelFor(jobSystem, static_cast<uint32_t>(batch.first.size()), constraintsPerJob, [&](uint32_t begin, uint32_t end) {
+                projectBatch(batch, begin, end, bendAlpha);
+            });
+        }
+
+        parallelFor(jobSystem, count, verticesPerJob, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                if (particles[i].w == 0.0f) {
+                    continue;
+                }
+                glm::vec3 p(particles[i]);
+                for (const Sphere& sphere : spheres) {
+                    glm::vec3 offset = p - sphere.center;
+                    float reach = sphere.radius + collisionMargin;
+                    float distanceSquared = glm::dot(offset, offset);
+                    if (distanceSquared < reach * reach && distanceSquared > 0.0f) {
+                        p = sphere.center + offset * (reach / std::sqrt(distanceSquared));
+                    }
+                }
+                if (hasGround) {
+                    p.y = std::max(p.y, groundHeight + collisionMargin);
+                }
+                particles[i] = glm::vec4(p, particles[i].w);
+                velocity[i] = (p - previous[i]) * (keep / h);
+            }
+        });
+    }
+
+    parallelFor(jobSystem, count, verticesPerJob, [&](uint32_t begin, uint32_t end) {
+        computeNormals(begin, end);
+    });
+}
+
+void Cloth::computeNormals(uint32_t begin, uint32_t end) {
+    // Central differences across the grid, one-sided along the border.
+    for (uint32_t i = begin; i < end; ++i) {
+        unsigned int r = i / (cols + 1);
+        unsigned int c = i % (cols + 1);
+        glm::vec3 alongRow = getPosition(vertexIndex(r, std::min(c + 1, cols))) - getPosition(vertexIndex(r, c > 0 ? c - 1 : 0));
+        glm::vec3 alongCol = getPosition(vertexIndex(std::min(r + 1, rows), c)) - getPosition(vertexIndex(r > 0 ? r - 1 : 0, c));
+        glm::vec3 normal = glm::cross(alongCol, alongRow);
+        float length = glm::length(normal);
+        normals[i] = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+}
+
+void Cloth::writeVertices(float* out) const {
+    uint32_t count = getVertexCount();
+    for (uint32_t i = 0; i < count; ++i) {
+        out[6 * i + 0] = particles[i].x;
+        out[6 * i + 1] = particles[i].y;
+        out[6 * i + 2] = particles[i].z;
+        out[6 * i + 3] = normals[i].x;
+        out[6 * i + 4] = normals[i].y;
+        out[6 * i + 5] = normals[i].z;
+    }
+}
+
+uint32_t Cloth::getConstraintCount() const {
+    uint32_t total = 0;
+    for (const ConstraintBatch& batch : stretchBatches) {
+        total += static_cast<uint32_t>(batch.first.size());
+    }
+    for (const ConstraintBatch& batch : bendBatches) {
+        total += static_cast<uint32_t>(batch.first.size());
+    }
+    return total;
+}
+
+uint32_t Cloth::getColorCount() const {
+    return static_cast<uint32_t>(stretchBatches.size() + bendBatches.size());
+}
@@ -0,0 +1,102 @@
+#ifndef CLOTH_H
+#define CLOTH_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Integrator.h"
+
+class JobSystem;
+
+// XPBD cloth on a rows x cols grid of quads, laid out like the Plane mesh:
+// (rows + 1) x (cols + 1) vertices in the xz plane, row-major, centred on
+// the origin given at construction.
+//
+// Every grid edge and quad diagonal is a distance constraint; vertices two
+// apart along a row or column are joined by a softer one that resists
+// bending. Each step is split into substeps that run one constraint pass each
+// (small-step XPBD), which converges better than many passes over one step
+// and needs no stored multipliers.
+//
+// Constraints are greedily graph-colored so that no two in a color share a
+// vertex; a color is then projected in parallel chunks and in SIMD batches
+// without any locking.
+class Cloth {
+public:
+    Cloth(float width, float depth, unsigned int rows, unsigned int cols, const glm::vec3& origin = glm::vec3(0.0f));
+
+    unsigned int getRows() const;
+    unsigned int getCols() const;
+    uint32_t getVertexCount() const;
+    uint32_t vertexIndex(unsigned int row, unsigned int col) const;
+
+    // Pinned vertices keep their position unless moved with setPosition.
+    void pin(uint32_t vertex, bool pinned = true);
+    void setPosition(uint32_t vertex, const glm::vec3& position);
+    glm::vec3 getPosition(uint32_t vertex) const;
+
+    void setGravity(const glm::vec3& gravity);
+    void setSubsteps(int substeps);
+    // Compliance is inverse stiffness in m/N; 0 is rigid.
+    void setStretchCompliance(float compliance);
+    void setBendCompliance(float compliance);
+    // Fraction of velocity lost per second.
+    void setDamping(float damping);
+
+    // Static spheres and an optional floor the cloth is pushed out of.
+    void addSphereCollider(const glm::vec3& center, float radius);
+    void clearColliders();
+    void setGround(bool enabled, float height = 0.0f);
+
+    void setJobSystem(JobSystem* jobs);
+    void setSimdLevel(SimdLevel level);
+    SimdLevel getSimdLevel() const;
+
+    void update(float deltaTime);
+
+    // Interleaved position and normal, 6 floats per vertex in index order:
+    // the layout Plane streams into its vertex buffer.
+    void writeVertices(float* out) const;
+
+    uint32_t getConstraintCount() const;
+    uint32_t getColorCount() const;
+
+private:
+    struct Sphere {
+        glm::vec3 center;
+        float radius;
+    };
+
+    // One color: constraints with no vertex in common.
+    struct ConstraintBatch {
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> second;
+        std::vector<float> restLength;
+    };
+
+    // pairs holds two vertex indices per constraint.
+    void colorConstraints(const std::vector<uint32_t>& pairs, std::vector<ConstraintBatch>& batches);
+    void projectBatch(const ConstraintBatch& batch, uint32_t begin, uint32_t end, float alpha);
+    void computeNormals(uint32_t begin, uint32_t end);
+
+    unsigned int rows;
+    unsigned int cols;
+    std::vector<glm::vec4> particles; // position, inverse mass in w
+    std::vector<glm::vec3> previous;
+    std::vector<glm::vec3> velocity;
+    std::vector<glm::vec3> normals;
+    std::vector<ConstraintBatch> stretchBatches;
+    std::vector<ConstraintBatch> bendBatches;
+    std::vector<Sphere> spheres;
+    JobSystem* jobSystem;
+    SimdLevel level;
+    glm::vec3 gravity;
+    int substeps;
+    float stretchCompliance;
+    float bendCompliance;
+    float damping;
+    bool hasGround;
+    float groundHeight;
+};
+
+#endif // CLOTH_H
@@ -0,0 +1,175 @@
+#include "Collider.h"
+#include <algorithm>
+
+Collider::Collider() : Collider(ColliderType::Sphere) {
+    radius = 0.5f;
+    cacheBounds();
+}
+
+Collider::Collider(ColliderType type)
+    : type(type), radius(0.0f), halfHeight(0.0f), halfExtents(0.0f), normal(0.0f, 1.0f, 0.0f),
+      orientation(1.0f, 0.0f, 0.0f, 0.0f), rotated(false), boundsMin(0.0f), boundsMax(0.0f),
+      boundingRadius(0.0f) {}
+
+Collider Collider::sphere(float radius) {
+    Collider collider(ColliderType::Sphere);
+    collider.radius = radius;
+    collider.cacheBounds();
+    return collider;
+}
+
+Collider Collider::box(const glm::vec3& halfExtents, const glm::quat& orientation) {
+    Collider collider(ColliderType::Box);
+    collider.halfExtents = halfExtents;
+    collider.orientation = glm::normalize(orientation);
+    collider.cacheBounds();
+    return collider;
+}
+
+Collider Collider::capsule(float radius, float halfHeight, const glm::quat& orientation) {
+    Collider collider(ColliderType::Capsule);
+    collider.radius = radius;
+    collider.halfHeight = halfHeight;
+    collider.orientation = glm::normalize(orientation);
+    collider.cacheBounds();
+    return collider;
+}
+
+Collider Collider::convexHull(const std::vector<glm::vec3>& points, const glm::quat& orientation) {
+    Collider collider(ColliderType::ConvexHull);
+    collider.points = std::make_shared<const std::vector<glm::vec3>>(points);
+    collider.orientation = glm::normalize(orientation);
+    collider.cacheBounds();
+    return collider;
+}
+
+Collider Collider::plane(const glm::vec3& normal) {
+    Collider collider(ColliderType::Plane);
+    collider.normal = glm::normalize(normal);
+    return collider;
+}
+
+ColliderType Collider::getType() const {
+    return type;
+}
+
+float Collider::getRadius() const {
+    return radius;
+}
+
+float Collider::getBoundingRadius() const {
+    return boundingRadius;
+}
+
+const glm::vec3& Collider::getNormal() const {
+    return normal;
+}
+
+glm::vec3 Collider::localSupport(const glm::vec3& direction) const {
+    switch (type) {
+    case ColliderType::Box:
+        return glm::vec3(direction.x < 0.0f ? -halfExtents.x : halfExtents.x,
+                         direction.y < 0.0f ? -halfExtents.y : halfExtents.y,
+                         direction.z < 0.0f ? -halfExtents.z : halfExtents.z);
+    case ColliderType::Capsule:
+        return glm::vec3(0.0f, direction.y < 0.0f ? -halfHeight : halfHeight, 0.0f);
+    case ColliderType::ConvexHull: {
+        const std::vector<glm::vec3>& hull = *points;
+        size_t best = 0;
+        float bestDot = glm::dot(hull[0], direction);
+        for (size_t i = 1; i < hull.size(); ++i) {
+            float d = glm::dot(hull[i], direction);
+            if (d > bestDot) {
+                bestDot = d;
+                best = i;
+            }
+        }
+        return hull[best];
+    }
+    case ColliderType::Sphere:
+    case ColliderType::Plane:
+    default:
+        return glm::vec3(0.0f);
+    }
+}
+
+glm::vec3 Collider::support(const glm::vec3& direction) const {
+    if (!rotated) {
+        return localSupport(direction);
+    }
+    return orientation * localSupport(glm::conjugate(orientation) * direction);
+}
+
+AABB Collider::bounds(const glm::vec3& position) const {
+    return AABB(position + boundsMin, position + boundsMax);
+}
+
+void Collider::cacheBounds() {
+    rotated = orientation != glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+    // The shape never turns, so six support queries give its exact bounds.
+    for (int axis = 0; axis < 3; ++axis) {
+        glm::vec3 direction(0.0f);
+        direction[axis] = 1.0f;
+        boundsMax[axis] = support(direction)[axis] + radius;
+        boundsMin[axis] = support(-direction)[axis] - radius;
+    }
+
+    float farthest = 0.0f;
+    switch (type) {
+    case ColliderType::Box:
+        farthest = glm::length(halfExtents);
+        break;
+    case ColliderType::Capsule:
+        farthest = halfHeight;
+        break;
+    case ColliderType::ConvexHull:
+        for (const glm::vec3& p : *points) {
+            farthest = std::max(farthest, glm::length(p));
+        }
+        break;
+    default:
+        break;
+    }
+    boundingRadius = farthest + radius;
+}
+
+void Collider::save(SnapshotWriter& out) const {
+    out.write(type);
+    out.write(radius);
+    out.write(halfHeight);
+    out.write(halfExtents);
+    out.write(normal);
+    out.write(orientation);
+    out.writeVector(points ? *points : std::vector<glm::vec3>());
+}
+
+Collider Collider::load(SnapshotReader& in) {
+    ColliderType type;
+    float radius, halfHeight;
+    glm::vec3 halfExtents, normal;
+    glm::quat orientation;
+    std::vector<glm::vec3> hull;
+    in.read(type);
+    in.read(radius);
+    in.read(halfHeight);
+    in.read(halfExtents);
+    in.read(normal);
+    in.read(orientation);
+    in.readVector(hull);
+
+    // Going through the factories recomputes the cached bounds exactly.
+    switch (type) {
+    case ColliderType::Box:
+        return box(halfExtents, orientation);
+    case ColliderType::Capsule:
+        return capsule(radius, halfHeight, orientation);
+    case ColliderType::ConvexHull:
+        return hull.empty() ? sphere(0.0f) : convexHull(hull, orientation);
+    case ColliderType::Plane:
+        return plane(normal);
+    case ColliderType::Sphere:
+    default:
+        return sphere(radius);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef COLLIDER_H
+#define COLLIDER_H
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "AABB.h"
+#include "Snapshot.h"
+
+enum class ColliderType {
+    Sphere,
+    Box,
+    Capsule,
+    ConvexHull,
+    Plane
+};
+
+// Convex shape attached to a body. Bodies carry no rotational state, so the
+// orientation is fixed when the collider is made and the bounds are cached.
+//
+// Spheres and capsules are a core point or segment inflated by a radius;
+// the narrowphase runs GJK on the core and adds the radius afterwards, which
+// keeps rounded shapes exact and cheap. A plane is an infinite static
+// half-space through the body position: bodies using one are made static and
+// kept out of the broadphase.
+class Collider {
+public:
+    Collider();
+
+    static Collider sphere(float radius);
+    static Collider box(const glm::vec3& halfExtents, const glm::quat& orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    // The core segment runs along the local y axis.
+    static Collider capsule(float radius, float halfHeight, const glm::quat& orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    // Points are relative to the body position; interior points are harmless.
+    static Collider convexHull(const std::vector<glm::vec3>& points, const glm::quat& orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    static Collider plane(const glm::vec3& normal);
+
+    ColliderType getType() const;
+    // Inflation around the core, zero for boxes and hulls.
+    float getRadius() const;
+    float getBoundingRadius() const;
+    const glm::vec3& getNormal() const;
+
+    // Furthest core point along direction, relative to the body position.
+    glm::vec3 support(const glm::vec3& direction) const;
+    AABB bounds(const glm::vec3& position) const;
+
+    void save(SnapshotWriter& out) const;
+    static Collider load(SnapshotReader& in);
+
+private:
+    explicit Collider(ColliderType type);
+    glm::vec3 localSupport(const glm::vec3& direction) const;
+    void cacheBounds();
+
+    ColliderType type;
+    float radius;
+    float halfHeight;
+    glm::vec3 halfExtents;
+    glm::vec3 normal;
+    glm::quat orientation;
+    bool rotated;
+    std::shared_ptr<const std::vector<glm::vec3>> points;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    float boundingRadius;
+};
+
+#endif // COLLIDER_H
@@ -0,0 +1,21 @@
+#ifndef CONTACT_H
+#define CONTACT_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Narrowphase result for a touching pair of packed body indices. The normal
+// points from b towards a. Contacts with the static world use b == world and
+// tell the surfaces apart through feature. A negative depth is the gap of a
+// pair that is close but not touching yet.
+struct Contact {
+    static constexpr uint32_t world = 0xffffffffu;
+
+    uint32_t a;
+    uint32_t b;
+    glm::vec3 normal;
+    float depth;
+    uint32_t feature = 0;
+};
+
+#endif // CONTACT_H
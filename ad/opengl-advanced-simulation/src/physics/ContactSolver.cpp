@@ -0,0 +1,199 @@
+#include "ContactSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+// Approach speeds below this don't bounce, which stops resting bodies from
+// hopping on restitution.
+static const float restitutionThreshold = 0.5f;
+// Penetration allowed before position correction kicks in, and the fraction
+// of the rest removed per step by the split impulse.
+static const float penetrationSlop = 0.005f;
+static const float correctionFactor = 0.8f;
+
+ContactSolver::ContactSolver() : iterations(8), warmStarting(true) {}
+
+void ContactSolver::setIterations(int newIterations) {
+    iterations = std::max(1, newIterations);
+}
+
+int ContactSolver::getIterations() const {
+    return iterations;
+}
+
+void ContactSolver::setWarmStarting(bool enabled) {
+    warmStarting = enabled;
+}
+
+void ContactSolver::clear() {
+    manifolds.clear();
+}
+
+size_t ContactSolver::getManifoldCount() const {
+    return manifolds.size();
+}
+
+static bool isWorld(uint32_t body) {
+    return body == Contact::world;
+}
+
+static glm::vec3 velocityOf(const BodyStorage& bodies, uint32_t body) {
+    return isWorld(body) ? glm::vec3(0.0f) : bodies.velocity(body);
+}
+
+static float inverseMassOf(const BodyStorage& bodies, uint32_t body) {
+    return isWorld(body) ? 0.0f : bodies.inverseMass[body];
+}
+
+void ContactSolver::applyImpulse(BodyStorage& bodies, const Constraint& c, const glm::vec3& impulse) const {
+    bodies.setVelocity(c.a, bodies.velocity(c.a) + impulse * bodies.inverseMass[c.a]);
+    if (!isWorld(c.b)) {
+        bodies.setVelocity(c.b, bodies.velocity(c.b) - impulse * bodies.inverseMass[c.b]);
+    }
+}
+
+void ContactSolver::solve(BodyStorage& bodies, const std::vector<Contact>& contacts, float deltaTime) {
+    constraints.clear();
+    constraintKeys.clear();
+
+    for (const Contact& contact : contacts) {
+        float inverseMassSum = bodies.inverseMass[contact.a] + inverseMassOf(bodies, contact.b);
+        if (inverseMassSum == 0.0f) {
+            continue;
+        }
+
+        Constraint c;
+        c.a = contact.a;
+        c.b = contact.b;
+        c.normal = contact.normal;
+        c.depth = contact.depth;
+        c.effectiveMass = 1.0f / inverseMassSum;
+        c.friction = isWorld(c.b) ? bodies.friction[c.a] : std::sqrt(bodies.friction[c.a] * bodies.friction[c.b]);
+        c.normalImpulse = 0.0f;
+        c.tangentImpulse = glm::vec3(0.0f);
+        c.positionBias = std::max(c.depth - penetrationSlop, 0.0f) * correctionFactor / deltaTime;
+        c.positionImpulse = 0.0f;
+
+        float approach = glm::dot(bodies.velocity(c.a) - velocityOf(bodies, c.b), c.normal);
+        float restitution = isWorld(c.b) ? bodies.restitution[c.a]
+                                         : std::min(bodies.restitution[c.a], bodies.restitution[c.b]);
+        if (approach < -restitutionThreshold && approach * deltaTime <= c.depth) {
+            // The gap, if any, closes within this step: bounce.
+            c.velocityTarget = -restitution * approach;
+        } else if (c.depth < 0.0f) {
+            // Speculative contact: the bodies may still close the gap this
+            // step, just not pass through each other.
+            c.velocityTarget = c.depth / deltaTime;
+        } else {
+            c.velocityTarget = 0.0f;
+        }
+
+        BodyHandle other = isWorld(c.b) ? BodyHandle{ Contact::world, contact.feature } : bodies.handleAt(c.b);
+        PairKey key = { bodies.handleAt(c.a), other };
+        if (warmStarting) {
+            auto cached = manifolds.find(key);
+            if (cached != manifolds.end()) {
+                // The normal may have turned a little; keep only the part of
+                // the old friction impulse that still lies in the tangent plane.
+                const Manifold& m = cached->second;
+                c.normalImpulse = m.normalImpulse;
+                c.tangentImpulse = m.tangentImpulse - c.normal * glm::dot(m.tangentImpulse, c.normal);
+            }
+        }
+
+        constraints.push_back(c);
+        constraintKeys.push_back(key);
+    }
+
+    // Warm start only after every approach speed has been measured, otherwise
+    // cached impulses would be mistaken for impacts by later contacts.
+    for (const Constraint& c : constraints) {
+        applyImpulse(bodies, c, c.normal * c.normalImpulse + c.tangentImpulse);
+    }
+
+    pseudoVelocity.assign(bodies.size(), glm::vec3(0.0f));
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        for (Constraint& c : constraints) {
+            glm::vec3 relative = bodies.velocity(c.a) - velocityOf(bodies, c.b);
+
+            // Normal row: accumulated impulse may only push.
+            float normalVelocity = glm::dot(relative, c.normal);
+            float lambda = c.effectiveMass * (c.velocityTarget - normalVelocity);
+            float previous = c.normalImpulse;
+            c.normalImpulse = std::max(previous + lambda, 0.0f);
+            applyImpulse(bodies, c, c.normal * (c.normalImpulse - previous));
+
+            // Friction row: cancel sliding, limited to the friction cone.
+            relative = bodies.velocity(c.a) - velocityOf(bodies, c.b);
+            glm::vec3 sliding = relative - c.normal * glm::dot(relative, c.normal);
+            glm::vec3 previousTangent = c.tangentImpulse;
+            glm::vec3 tangent = previousTangent - sliding * c.effectiveMass;
+            float maxFriction = c.friction * c.normalImpulse;
+            float length = glm::length(tangent);
+            if (length > maxFriction) {
+                tangent *= maxFriction / length;
+            }
+            c.tangentImpulse = tangent;
+            applyImpulse(bodies, c, tangent - previousTangent);
+
+            // Position row on the pseudo-velocities, never warm started.
+            glm::vec3 pseudoRelative = pseudoVelocity[c.a];
+            if (!isWorld(c.b)) {
+                pseudoRelative -= pseudoVelocity[c.b];
+            }
+            float pseudoLambda = c.effectiveMass * (c.positionBias - glm::dot(pseudoRelative, c.normal));
+            float previousPosition = c.positionImpulse;
+            c.positionImpulse = std::max(previousPosition + pseudoLambda, 0.0f);
+            glm::vec3 push = c.normal * (c.positionImpulse - previousPosition);
+            pseudoVelocity[c.a] += push * bodies.inverseMass[c.a];
+            if (!isWorld(c.b)) {
+                pseudoVelocity[c.b] -= push * bodies.inverseMass[c.b];
+            }
+        }
+    }
+
+    // Only pairs that touched this frame stay cached.
+    manifolds.clear();
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        manifolds[constraintKeys[i]] = { constraints[i].normalImpulse, constraints[i].tangentImpulse };
+    }
+
+    for (const Constraint& c : constraints) {
+        for (uint32_t body : { c.a, c.b }) {
+            if (!isWorld(body) && pseudoVelocity[body] != glm::vec3(0.0f)) {
+                bodies.setPosition(body, bodies.position(body) + pseudoVelocity[body] * deltaTime);
+                pseudoVelocity[body] = glm::vec3(0.0f);
+            }
+        }
+    }
+}
+
+void ContactSolver::save(SnapshotWriter& out) const {
+    out.write(iterations);
+    out.write(warmStarting);
+
+    // Sorted, so equal states give equal bytes whatever the hash map did.
+    std::vector<ManifoldEntry> entries;
+    entries.reserve(manifolds.size());
+    for (const auto& entry : manifolds) {
+        entries.push_back({ entry.first, entry.second });
+    }
+    std::sort(entries.begin(), entries.end(), [](const ManifoldEntry& x, const ManifoldEntry& y) {
+        return std::tie(x.key.a.index, x.key.a.generation, x.key.b.index, x.key.b.generation) <
+               std::tie(y.key.a.index, y.key.a.generation, y.key.b.index, y.key.b.generation);
+    });
+    out.writeVector(entries);
+}
+
+bool ContactSolver::load(SnapshotReader& in) {
+    std::vector<ManifoldEntry> entries;
+    in.read(iterations);
+    in.read(warmStarting);
+    in.readVector(entries);
+    manifolds.clear();
+    for (const ManifoldEntry& entry : entries) {
+        manifolds[entry.key] = entry.manifold;
+    }
+    iterations = std::max(1, iterations);
+    return in.ok();
+}
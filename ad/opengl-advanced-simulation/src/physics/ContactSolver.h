@@ -0,0 +1,94 @@
+#ifndef CONTACT_SOLVER_H
+#define CONTACT_SOLVER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BodyStorage.h"
+#include "Contact.h"
+#include "Snapshot.h"
+
+// Sequential impulse solver. Every touching pair gets a manifold that is
+// cached across frames by the pair's body handles; the impulses it
+// accumulated last frame are applied up front (warm starting), so a few
+// iterations are enough for resting stacks to settle instead of jittering.
+//
+// Bodies carry no rotational state, so a manifold needs a single point: one
+// non-penetration row along the normal plus a friction row in the tangent
+// plane, clamped by the friction cone.
+class ContactSolver {
+public:
+    ContactSolver();
+
+    void setIterations(int iterations);
+    int getIterations() const;
+    void setWarmStarting(bool enabled);
+
+    // Resolves velocities for the given contacts, then pushes bodies apart
+    // by the remaining penetration. Contacts with a negative depth are
+    // speculative: they only stop the gap from closing past zero.
+    //
+    // Penetration is removed with split impulses: a second set of rows
+    // solves pseudo-velocities that move positions but are thrown away
+    // afterwards, so pushing out of overlap never adds kinetic energy.
+    void solve(BodyStorage& bodies, const std::vector<Contact>& contacts, float deltaTime);
+    void clear();
+    size_t getManifoldCount() const;
+
+    // Settings and cached impulses, so warm starting resumes exactly.
+    void save(SnapshotWriter& out) const;
+    bool load(SnapshotReader& in);
+
+private:
+    struct PairKey {
+        BodyHandle a;
+        BodyHandle b;
+
+        bool operator==(const PairKey& other) const {
+            return a == other.a && b == other.b;
+        }
+    };
+
+    struct PairKeyHash {
+        size_t operator()(const PairKey& key) const {
+            uint64_t h = (static_cast<uint64_t>(key.a.index) << 32 | key.b.index) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(h ^ (h >> 29) ^ (static_cast<uint64_t>(key.a.generation ^ key.b.generation) << 7));
+        }
+    };
+
+    struct Manifold {
+        float normalImpulse;
+        glm::vec3 tangentImpulse;
+    };
+
+    struct ManifoldEntry {
+        PairKey key;
+        Manifold manifold;
+    };
+
+    struct Constraint {
+        uint32_t a;
+        uint32_t b;
+        glm::vec3 normal;
+        float depth;
+        float effectiveMass;
+        float velocityTarget;
+        float friction;
+        float normalImpulse;
+        glm::vec3 tangentImpulse;
+        float positionBias;
+        float positionImpulse;
+    };
+
+    void applyImpulse(BodyStorage& bodies, const Constraint& c, const glm::vec3& impulse) const;
+
+    int iterations;
+    bool warmStarting;
+    std::vector<Constraint> constraints;
+    std::vector<PairKey> constraintKeys;
+    std::vector<glm::vec3> pseudoVelocity;
+    std::unordered_map<PairKey, Manifold, PairKeyHash> manifolds;
+};
+
+#endif // CONTACT_SOLVER_H
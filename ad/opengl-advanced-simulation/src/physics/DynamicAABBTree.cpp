@@ -0,0 +1,269 @@
+#include "DynamicAABBTree.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+DynamicAABBTree::DynamicAABBTree()
+    : root(nullNode), freeList(nullNode), proxyCount(0), margin(0.1f) {}
+
+void DynamicAABBTree::setMargin(float newMargin) {
+    margin = newMargin;
+}
+
+float DynamicAABBTree::surfaceArea(const AABB& box) {
+    glm::vec3 d = box.extents();
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool DynamicAABBTree::rayOverlaps(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+    // Slab test; infinities from zero direction components work out.
+    glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    return enter <= exit;
+}
+
+int DynamicAABBTree::allocateNode() {
+    if (freeList == nullNode) {
+        Node node;
+        node.userData = nullptr;
+        node.parent = nullNode;
+        node.child1 = nullNode;
+        node.child2 = nullNode;
+        node.height = -1;
+        nodes.push_back(node);
+        freeList = static_cast<int>(nodes.size()) - 1;
+        nodes[freeList].parent = nullNode;
+    }
+
+    int nodeId = freeList;
+    freeList = nodes[nodeId].parent;
+    Node& node = nodes[nodeId];
+    node.userData = nullptr;
+    node.parent = nullNode;
+    node.child1 = nullNode;
+    node.child2 = nullNode;
+    node.height = 0;
+    return nodeId;
+}
+
+void DynamicAABBTree::freeNode(int nodeId) {
+    nodes[nodeId].parent = freeList;
+    nodes[nodeId].height = -1;
+    freeList = nodeId;
+}
+
+int DynamicAABBTree::createProxy(const AABB& box, void* userData) {
+    int proxyId = allocateNode();
+    nodes[proxyId].box = AABB(box.min - glm::vec3(margin), box.max + glm::vec3(margin));
+    nodes[proxyId].userData = userData;
+    insertLeaf(proxyId);
+    ++proxyCount;
+    return proxyId;
+}
+
+void DynamicAABBTree::destroyProxy(int proxyId) {
+    assert(nodes[proxyId].isLeaf());
+    removeLeaf(proxyId);
+    freeNode(proxyId);
+    --proxyCount;
+}
+
+bool DynamicAABBTree::moveProxy(int proxyId, const AABB& box, const glm::vec3& displacement) {
+    assert(nodes[proxyId].isLeaf());
+    if (nodes[proxyId].box.contains(box)) {
+        return false;
+    }
+
+    // Grow the new fat box in the direction of motion so a steadily moving
+    // body doesn't need reinserting every frame.
+    AABB fat(box.min - glm::vec3(margin), box.max + glm::vec3(margin));
+    glm::vec3 predicted = 2.0f * displacement;
+    fat.min = glm::min(fat.min, fat.min + predicted);
+    fat.max = glm::max(fat.max, fat.max + predicted);
+
+    removeLeaf(proxyId);
+    nodes[proxyId].box = fat;
+    insertLeaf(proxyId);
+    return true;
+}
+
+void* DynamicAABBTree::getUserData(int proxyId) const {
+    return nodes[proxyId].userData;
+}
+
+const AABB& DynamicAABBTree::getFatAABB(int proxyId) const {
+    return nodes[proxyId].box;
+}
+
+int DynamicAABBTree::getHeight() const {
+    return root == nullNode ? 0 : nodes[root].height;
+}
+
+int DynamicAABBTree::getProxyCount() const {
+    return proxyCount;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf) {
+    if (root == nullNode) {
+        root = leaf;
+        nodes[root].parent = nullNode;
+        return;
+    }
+
+    // Walk down picking the child whose surface area grows the least.
+    AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf()) {
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+
+        float area = surfaceArea(nodes[index].box);
+        float combinedArea = surfaceArea(nodes[index].box.merged(leafBox));
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            float mergedArea = surfaceArea(leafBox.merged(nodes[child].box));
+            if (nodes[child].isLeaf()) {
+                return mergedArea + inheritanceCost;
+            }
+            return mergedArea - surfaceArea(nodes[child].box) + inheritanceCost;
+        };
+        float cost1 = descendCost(child1);
+        float cost2 = descendCost(child2);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? child1 : child2;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = leafBox.merged(nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != nullNode) {
+        if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+    } else {
+        root = newParent;
+    }
+
+    refit(nodes[leaf].parent);
+}
+
+void DynamicAABBTree::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = nullNode;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent != nullNode) {
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refit(grandParent);
+    } else {
+        root = sibling;
+        nodes[sibling].parent = nullNode;
+        freeNode(parent);
+    }
+}
+
+void DynamicAABBTree::refit(int nodeId) {
+    // Walk back up, rotating unbalanced nodes and refitting boxes and heights.
+    while (nodeId != nullNode) {
+        nodeId = balance(nodeId);
+
+        Node& node = nodes[nodeId];
+        const Node& child1 = nodes[node.child1];
+        const Node& child2 = nodes[node.child2];
+        node.height = 1 + std::max(child1.height, child2.height);
+        node.box = child1.box.merged(child2.box);
+
+        nodeId = node.parent;
+    }
+}
+
+int DynamicAABBTree::balance(int iA) {
+    Node& A = nodes[iA];
+    if (A.isLeaf() || A.height < 2) {
+        return iA;
+    }
+
+    int iB = A.child1;
+    int iC = A.child2;
+    int heightDifference = nodes[iC].height - nodes[iB].height;
+
+    // Rotate the taller child up into A's place.
+    auto rotateUp = [&](int iUp, int iStay) {
+        Node& up = nodes[iUp];
+        int iF = up.child1;
+        int iG = up.child2;
+
+        up.child1 = iA;
+        up.parent = A.parent;
+        A.parent = iUp;
+
+        if (up.parent != nullNode) {
+            if (nodes[up.parent].child1 == iA) {
+                nodes[up.parent].child1 = iUp;
+            } else {
+                nodes[up.parent].child2 = iUp;
+            }
+        } else {
+            root = iUp;
+        }
+
+        // Keep the taller grandchild under the rotated node.
+        int iKeep = iF;
+        int iMove = iG;
+        if (nodes[iF].height < nodes[iG].height) {
+            iKeep = iG;
+            iMove = iF;
+        }
+        up.child2 = iKeep;
+        if (A.child1 == iUp) {
+            A.child1 = iMove;
+        } else {
+            A.child2 = iMove;
+        }
+        nodes[iMove].parent = iA;
+
+        A.box = nodes[iStay].box.merged(nodes[iMove].box);
+        A.height = 1 + std::max(nodes[iStay].height, nodes[iMove].height);
+        up.box = A.box.merged(nodes[iKeep].box);
+        up.height = 1 + std::max(A.height, nodes[iKeep].height);
+        return iUp;
+    };
+
+    if (heightDifference > 1) {
+        return rotateUp(iC, iB);
+    }
+    if (heightDifference < -1) {
+        return rotateUp(iB, iC);
+    }
+    return iA;
+}
@@ -0,0 +1,124 @@
+#ifndef DYNAMIC_AABB_TREE_H
+#define DYNAMIC_AABB_TREE_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "AABB.h"
+
+// Bounding volume hierarchy over fattened boxes. Leaves only get reinserted
+// when a body leaves its fat box, and the tree is kept balanced with local
+// rotations, so keeping it in sync with moving bodies is cheap.
+class DynamicAABBTree {
+public:
+    static constexpr int nullNode = -1;
+
+    DynamicAABBTree();
+
+    // Extra space added around every leaf box.
+    void setMargin(float margin);
+
+    int createProxy(const AABB& box, void* userData);
+    void destroyProxy(int proxyId);
+    // Returns true when the proxy had to be reinserted.
+    bool moveProxy(int proxyId, const AABB& box, const glm::vec3& displacement);
+
+    void* getUserData(int proxyId) const;
+    const AABB& getFatAABB(int proxyId) const;
+    int getHeight() const;
+    int getProxyCount() const;
+
+    // callback(int proxyId) -> bool, return false to stop the query.
+    template <typename Callback>
+    void query(const AABB& box, Callback callback) const;
+
+    // callback(int proxyId, float maxDistance) -> float. The returned value
+    // clips the ray: 0 stops the cast, maxDistance keeps it unchanged.
+    template <typename Callback>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback callback) const;
+
+private:
+    struct Node {
+        AABB box;
+        void* userData;
+        int parent; // also the free list link
+        int child1;
+        int child2;
+        int height; // 0 for leaves, -1 for free nodes
+
+        bool isLeaf() const { return child1 == nullNode; }
+    };
+
+    int allocateNode();
+    void freeNode(int nodeId);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int balance(int nodeId);
+    void refit(int nodeId);
+
+    static float surfaceArea(const AABB& box);
+    static bool rayOverlaps(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance);
+
+    std::vector<Node> nodes;
+    int root;
+    int freeList;
+    int proxyCount;
+    float margin;
+};
+
+template <typename Callback>
+void DynamicAABBTree::query(const AABB& box, Callback callback) const {
+    if (root == nullNode) {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        const Node& node = nodes[nodeId];
+        if (!node.box.overlaps(box)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (!callback(nodeId)) {
+                return;
+            }
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicAABBTree::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback callback) const {
+    if (root == nullNode) {
+        return;
+    }
+
+    glm::vec3 inverseDirection = 1.0f / direction;
+    std::vector<int> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        int nodeId = stack.back();
+        stack.pop_back();
+
+        const Node& node = nodes[nodeId];
+        if (!rayOverlaps(node.box, origin, inverseDirection, maxDistance)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            maxDistance = callback(nodeId, maxDistance);
+            if (maxDistance <= 0.0f) {
+                return;
+            }
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+#endif // DYNAMIC_AABB_TREE_H
@@ -0,0 +1,226 @@
+#include "Integrator.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+struct Columns {
+    float* position[3];
+    float* velocity[3];
+    float* force[3];
+    const float* inverseMass;
+    uint32_t count;
+};
+
+Columns columnsOf(BodyStorage& bodies, uint32_t begin, uint32_t end) {
+    Columns c;
+    c.position[0] = bodies.positionX.data() + begin;
+    c.position[1] = bodies.positionY.data() + begin;
+    c.position[2] = bodies.positionZ.data() + begin;
+    c.velocity[0] = bodies.velocityX.data() + begin;
+    c.velocity[1] = bodies.velocityY.data() + begin;
+    c.velocity[2] = bodies.velocityZ.data() + begin;
+    c.force[0] = bodies.forceX.data() + begin;
+    c.force[1] = bodies.forceY.data() + begin;
+    c.force[2] = bodies.forceZ.data() + begin;
+    c.inverseMass = bodies.inverseMass.data() + begin;
+    c.count = end - begin;
+    return c;
+}
+
+void integrateScalar(const Columns& c, uint32_t begin, const glm::vec3& gravity, float dt) {
+    for (int axis = 0; axis < 3; ++axis) {
+        float* p = c.position[axis];
+        float* v = c.velocity[axis];
+        float* f = c.force[axis];
+        float g = gravity[axis];
+        for (uint32_t i = begin; i < c.count; ++i) {
+            if (c.inverseMass[i] > 0.0f) {
+                v[i] = v[i] + (f[i] * c.inverseMass[i] + g) * dt;
+                p[i] = p[i] + v[i] * dt;
+            }
+            f[i] = 0.0f;
+        }
+    }
+}
+
+#ifdef PHYSICS_SIMD_X86
+
+PHYSICS_TARGET_SSE2 uint32_t integrateSSE(const Columns& c, const glm::vec3& gravity, float dt) {
+    uint32_t end = c.count & ~3u;
+    __m128 step = _mm_set1_ps(dt);
+    __m128 zero = _mm_setzero_ps();
+    for (int axis = 0; axis < 3; ++axis) {
+        float* p = c.position[axis];
+        float* v = c.velocity[axis];
+        float* f = c.force[axis];
+        __m128 g = _mm_set1_ps(gravity[axis]);
+        for (uint32_t i = 0; i < end; i += 4) {
+            __m128 inverseMass = _mm_loadu_ps(c.inverseMass + i);
+            __m128 dynamic = _mm_cmpgt_ps(inverseMass, zero);
+            __m128 velocity = _mm_loadu_ps(v + i);
+            __m128 position = _mm_loadu_ps(p + i);
+
+            __m128 acceleration = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(f + i), inverseMass), g);
+            __m128 newVelocity = _mm_add_ps(velocity, _mm_mul_ps(acceleration, step));
+            __m128 newPosition = _mm_add_ps(position, _mm_mul_ps(newVelocity, step));
+
+            // Select without SSE4.1 blendv: (mask & new) | (~mask & old)
+            _mm_storeu_ps(v + i, _mm_or_ps(_mm_and_ps(dynamic, newVelocity), _mm_andnot_ps(dynamic, velocity)));
+            _mm_storeu_ps(p + i, _mm_or_ps(_mm_and_ps(dynamic, newPosition), _mm_andnot_ps(dynamic, position)));
+            _mm_storeu_ps(f + i, zero);
+        }
+    }
+    return end;
+}
+
+PHYSICS_TARGET_AVX2 uint32_t integrateAVX2(const Columns& c, const glm::vec3& gravity, float dt) {
+    uint32_t end = c.count & ~7u;
+    __m256 step = _mm256_set1_ps(dt);
+    __m256 zero = _mm256_setzero_ps();
+    for (int axis = 0; axis < 3; ++axis) {
+        float* p = c.position[axis];
+        float* v = c.velocity[axis];
+        float* f = c.force[axis];
+        __m256 g = _mm256_set1_ps(gravity[axis]);
+        for (uint32_t i = 0; i < end; i += 8) {
+            __m256 inverseMass = _mm256_loadu_ps(c.inverseMass + i);
+            __m256 dynamic = _mm256_cmp_ps(inverseMass, zero, _CMP_GT_OQ);
+            __m256 velocity = _mm256_loadu_ps(v + i);
+            __m256 position = _mm256_loadu_ps(p + i);
+
+            __m256 acceleration = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(f + i), inverseMass), g);
+            __m256 newVelocity = _mm256_add_ps(velocity, _mm256_mul_ps(acceleration, step));
+            __m256 newPosition = _mm256_add_ps(position, _mm256_mul_ps(newVelocity, step));
+
+            _mm256_storeu_ps(v + i, _mm256_blendv_ps(velocity, newVelocity, dynamic));
+            _mm256_storeu_ps(p + i, _mm256_blendv_ps(position, newPosition, dynamic));
+            _mm256_storeu_ps(f + i, zero);
+        }
+    }
+    return end;
+}
+
+PHYSICS_TARGET_AVX2_FMA uint32_t integrateAVX2Fma(const Columns& c, const glm::vec3& gravity, float dt) {
+    uint32_t end = c.count & ~7u;
+    __m256 step = _mm256_set1_ps(dt);
+    __m256 zero = _mm256_setzero_ps();
+    for (int axis = 0; axis < 3; ++axis) {
+        float* p = c.position[axis];
+        float* v = c.velocity[axis];
+        float* f = c.force[axis];
+        __m256 g = _mm256_set1_ps(gravity[axis]);
+        for (uint32_t i = 0; i < end; i += 8) {
+            __m256 inverseMass = _mm256_loadu_ps(c.inverseMass + i);
+            __m256 dynamic = _mm256_cmp_ps(inverseMass, zero, _CMP_GT_OQ);
+            __m256 velocity = _mm256_loadu_ps(v + i);
+            __m256 position = _mm256_loadu_ps(p + i);
+
+            __m256 acceleration = _mm256_fmadd_ps(_mm256_loadu_ps(f + i), inverseMass, g);
+            __m256 newVelocity = _mm256_fmadd_ps(acceleration, step, velocity);
+            __m256 newPosition = _mm256_fmadd_ps(newVelocity, step, position);
+
+            _mm256_storeu_ps(v + i, _mm256_blendv_ps(velocity, newVelocity, dynamic));
+            _mm256_storeu_ps(p + i, _mm256_blendv_ps(position, newPosition, dynamic));
+            _mm256_storeu_ps(f + i, zero);
+        }
+    }
+    return end;
+}
+
+bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+bool cpuSupportsSSE() {
+#if defined(_MSC_VER) || defined(__x86_64__)
+    return true; // SSE2 is part of x86-64
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif // PHYSICS_SIMD_X86
+
+} // namespace
+
+Integrator::Integrator() : level(detectSimdLevel()), deterministic(false) {}
+
+SimdLevel Integrator::detectSimdLevel() {
+#ifdef PHYSICS_SIMD_X86
+    static const SimdLevel detected = cpuSupportsAVX2() ? SimdLevel::AVX2
+                                    : cpuSupportsSSE()  ? SimdLevel::SSE
+                                                        : SimdLevel::Scalar;
+    return detected;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* Integrator::simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::SSE:
+        return "sse";
+    case SimdLevel::Scalar:
+    default:
+        return "scalar";
+    }
+}
+
+void Integrator::setSimdLevel(SimdLevel requested) {
+    level = std::min(requested, detectSimdLevel());
+}
+
+SimdLevel Integrator::getSimdLevel() const {
+    return level;
+}
+
+void Integrator::setDeterministic(bool enabled) {
+    deterministic = enabled;
+}
+
+bool Integrator::isDeterministic() const {
+    return deterministic;
+}
+
+void Integrator::integrate(BodyStorage& bodies, const glm::vec3& gravity, float deltaTime) const {
+    integrate(bodies, gravity, deltaTime, 0, bodies.size());
+}
+
+void Integrator::integrate(BodyStorage& bodies, const glm::vec3& gravity, float deltaTime, uint32_t begin, uint32_t end) const {
+    Columns columns = columnsOf(bodies, begin, end);
+    uint32_t done = 0;
+
+#ifdef PHYSICS_SIMD_X86
+    if (level == SimdLevel::AVX2) {
+        done = deterministic ? integrateAVX2(columns, gravity, deltaTime)
+                             : integrateAVX2Fma(columns, gravity, deltaTime);
+    } else if (level == SimdLevel::SSE) {
+        done = integrateSSE(columns, gravity, deltaTime);
+    }
+#endif
+
+    // Remainder that doesn't fill a whole vector, or everything without SIMD.
+    integrateScalar(columns, done, gravity, deltaTime);
+}
@@ -0,0 +1,43 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <glm/glm.hpp>
+#include "BodyStorage.h"
+
+enum class SimdLevel {
+    Scalar,
+    SSE,  // 4 bodies per instruction
+    AVX2  // 8 bodies per instruction
+};
+
+// Semi-implicit Euler over the packed body columns:
+//   v += (f * inverseMass + gravity) * dt;  p += v * dt;  f = 0
+// Bodies with zero inverse mass don't move. The widest kernel the CPU supports
+// is picked at runtime. In deterministic mode the vector kernels use the exact
+// same multiply/add sequence as the scalar loop, so every level produces
+// bit-identical results; otherwise AVX2 is allowed to fuse them into FMAs.
+class Integrator {
+public:
+    Integrator();
+
+    static SimdLevel detectSimdLevel();
+    static const char* simdLevelName(SimdLevel level);
+
+    // Requests a level; anything the CPU can't run falls back to the best
+    // supported one.
+    void setSimdLevel(SimdLevel level);
+    SimdLevel getSimdLevel() const;
+    void setDeterministic(bool deterministic);
+    bool isDeterministic() const;
+
+    void integrate(BodyStorage& bodies, const glm::vec3& gravity, float deltaTime) const;
+    // Integrates the packed bodies [begin, end) only, so ranges can run on
+    // different threads.
+    void integrate(BodyStorage& bodies, const glm::vec3& gravity, float deltaTime, uint32_t begin, uint32_t end) const;
+
+private:
+    SimdLevel level;
+    bool deterministic;
+};
+
+#endif // INTEGRATOR_H
@@ -0,0 +1,221 @@
+#include "IslandManager.h"
+#include <algorithm>
+
+static const uint32_t noIsland = 0xffffffffu;
+
+IslandManager::IslandManager()
+    : enabled(true), sleepSpeed(0.05f), sleepSteps(30), islandCount(0), nextIsland(0) {}
+
+void IslandManager::setEnabled(bool newEnabled) {
+    enabled = newEnabled;
+}
+
+bool IslandManager::isEnabled() const {
+    return enabled;
+}
+
+void IslandManager::setThreshold(float speed, uint32_t steps) {
+    sleepSpeed = std::max(speed, 0.0f);
+    sleepSteps = std::max(steps, 1u);
+}
+
+void IslandManager::addBody(BodyHandle handle) {
+    if (quietSteps.size() <= handle.index) {
+        quietSteps.resize(handle.index + 1);
+        slotIsland.resize(handle.index + 1);
+    }
+    quietSteps[handle.index] = 0;
+    slotIsland[handle.index] = noIsland;
+}
+
+uint32_t IslandManager::findRoot(uint32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+bool IslandManager::update(BodyStorage& bodies, const std::vector<Contact>& contacts) {
+    if (!enabled) {
+        islandCount = 0;
+        return false;
+    }
+
+    uint32_t awake = bodies.awakeCount();
+    float speedSquared = sleepSpeed * sleepSpeed;
+    parent.resize(awake);
+    islandQuiet.assign(awake, sleepSteps);
+    islandBlocked.assign(awake, 0);
+    islandId.assign(awake, noIsland);
+    for (uint32_t i = 0; i < awake; ++i) {
+        parent[i] = i;
+        uint32_t& quiet = quietSteps[bodies.handleAt(i).index];
+        glm::vec3 v = bodies.velocity(i);
+        quiet = glm::dot(v, v) < speedSquared ? std::min(quiet + 1, sleepSteps) : 0;
+    }
+
+    // Link awake dynamic bodies that touch; a touched sleeping island is
+    // queued for waking and keeps the toucher's island up this step.
+    wakeList.clear();
+    for (const Contact& c : contacts) {
+        if (c.b == Contact::world || bodies.inverseMass[c.a] == 0.0f || bodies.inverseMass[c.b] == 0.0f) {
+            continue;
+        }
+        bool awakeA = bodies.isAwake(c.a);
+        bool awakeB = bodies.isAwake(c.b);
+        if (awakeA && awakeB) {
+            uint32_t rootA = findRoot(c.a);
+            uint32_t rootB = findRoot(c.b);
+            if (rootA != rootB) {
+                parent[std::max(rootA, rootB)] = std::min(rootA, rootB);
+            }
+        } else if (awakeA != awakeB) {
+            wakeList.push_back(slotIsland[bodies.handleAt(awakeA ? c.b : c.a).index]);
+        }
+    }
+    if (!wakeList.empty()) {
+        for (const Contact& c : contacts) {
+            if (c.b != Contact::world && bodies.inverseMass[c.a] != 0.0f && bodies.inverseMass[c.b] != 0.0f &&
+                bodies.isAwake(c.a) != bodies.isAwake(c.b)) {
+                islandBlocked[findRoot(bodies.isAwake(c.a) ? c.a : c.b)] = 1;
+            }
+        }
+    }
+
+    islandCount = 0;
+    for (uint32_t i = 0; i < awake; ++i) {
+        uint32_t root = findRoot(i);
+        islandCount += root == i;
+        islandQuiet[root] = std::min(islandQuiet[root], quietSteps[bodies.handleAt(i).index]);
+    }
+
+    // Collect by handle first: falling asleep swaps packed indices around.
+    uint32_t firstNew = nextIsland;
+    for (uint32_t i = 0; i < awake; ++i) {
+        uint32_t root = findRoot(i);
+        if (islandQuiet[root] < sleepSteps || islandBlocked[root]) {
+            continue;
+        }
+        if (islandId[root] == noIsland) {
+            islandId[root] = nextIsland++;
+        }
+        sleeping[islandId[root]].push_back(bodies.handleAt(i));
+    }
+    for (uint32_t island = firstNew; island != nextIsland; ++island) {
+        for (BodyHandle handle : sleeping[island]) {
+            bodies.sleep(handle);
+            uint32_t i = bodies.denseIndex(handle);
+            bodies.setVelocity(i, glm::vec3(0.0f));
+            bodies.forceX[i] = bodies.forceY[i] = bodies.forceZ[i] = 0.0f;
+            bodies.setPreviousPosition(i, bodies.position(i));
+            slotIsland[handle.index] = island;
+        }
+    }
+    islandCount -= nextIsland - firstNew;
+
+    for (uint32_t island : wakeList) {
+        wakeIsland(bodies, island);
+    }
+    return nextIsland != firstNew || !wakeList.empty();
+}
+
+void IslandManager::wakeIsland(BodyStorage& bodies, uint32_t island) {
+    auto it = sleeping.find(island);
+    if (it == sleeping.end()) {
+        return;
+    }
+    for (BodyHandle handle : it->second) {
+        bodies.wake(handle);
+        quietSteps[handle.index] = 0;
+        slotIsland[handle.index] = noIsland;
+    }
+    sleeping.erase(it);
+}
+
+void IslandManager::wake(BodyStorage& bodies, BodyHandle handle) {
+    if (!bodies.isValid(handle)) {
+        return;
+    }
+    quietSteps[handle.index] = 0;
+    if (!bodies.isAwake(bodies.denseIndex(handle))) {
+        wakeIsland(bodies, slotIsland[handle.index]);
+    }
+}
+
+void IslandManager::wakeAll(BodyStorage& bodies) {
+    // Oldest island first, so the packed order doesn't depend on the hash map.
+    std::vector<uint32_t> islands;
+    for (const auto& entry : sleeping) {
+        islands.push_back(entry.first);
+    }
+    std::sort(islands.begin(), islands.end());
+    for (uint32_t island : islands) {
+        wakeIsland(bodies, island);
+    }
+}
+
+uint32_t IslandManager::getIslandCount() const {
+    return islandCount;
+}
+
+size_t IslandManager::getSleepingIslandCount() const {
+    return sleeping.size();
+}
+
+void IslandManager::save(SnapshotWriter& out) const {
+    out.write(enabled);
+    out.write(sleepSpeed);
+    out.write(sleepSteps);
+    out.write(islandCount);
+    out.write(nextIsland);
+    out.writeVector(quietSteps);
+    out.writeVector(slotIsland);
+
+    // Island members are kept in the order they fell asleep, which decides
+    // where they land when they wake.
+    std::vector<uint32_t> islands;
+    for (const auto& entry : sleeping) {
+        islands.push_back(entry.first);
+    }
+    std::sort(islands.begin(), islands.end());
+    out.write(static_cast<uint64_t>(islands.size()));
+    for (uint32_t island : islands) {
+        out.write(island);
+        out.writeVector(sleeping.at(island));
+    }
+}
+
+bool IslandManager::load(SnapshotReader& in) {
+    uint64_t islands = 0;
+    in.read(enabled);
+    in.read(sleepSpeed);
+    in.read(sleepSteps);
+    in.read(islandCount);
+    in.read(nextIsland);
+    in.readVector(quietSteps);
+    in.readVector(slotIsland);
+    in.read(islands);
+    sleeping.clear();
+    for (uint64_t i = 0; i < islands && in.ok(); ++i) {
+        uint32_t island = 0;
+        in.read(island);
+        in.readVector(sleeping[island]);
+    }
+    sleepSteps = std::max(sleepSteps, 1u);
+    return in.ok() && quietSteps.size() == slotIsland.size();
+}
+
+bool IslandManager::isConsistentWith(const BodyStorage& bodies) const {
+    if (quietSteps.size() < bodies.slotCount()) {
+        return false;
+    }
+    for (const auto& entry : sleeping) {
+        for (BodyHandle handle : entry.second) {
+            if (!bodies.isValid(handle) || bodies.isAwake(bodies.denseIndex(handle))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
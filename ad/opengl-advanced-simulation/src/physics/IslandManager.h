@@ -0,0 +1,65 @@
+#ifndef ISLAND_MANAGER_H
+#define ISLAND_MANAGER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "BodyStorage.h"
+#include "Contact.h"
+#include "Snapshot.h"
+
+// Groups awake bodies into islands (connected components of the contact
+// graph) with union-find, and puts an island to sleep once every body in it
+// has stayed slower than the threshold for enough consecutive steps. A
+// sleeping island is woken as a whole when an awake body touches it or when
+// one of its bodies is poked through the engine API.
+//
+// Static bodies (zero inverse mass) never join islands, so a floor shared by
+// two piles doesn't keep both awake.
+class IslandManager {
+public:
+    IslandManager();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setThreshold(float speed, uint32_t steps);
+
+    // Resets per-body state for a freshly created body.
+    void addBody(BodyHandle handle);
+    // Runs after the solver. Returns true if any body fell asleep or woke,
+    // which reorders the packed body columns.
+    bool update(BodyStorage& bodies, const std::vector<Contact>& contacts);
+    // Wakes the island the body sleeps in and restarts its quiet count.
+    void wake(BodyStorage& bodies, BodyHandle handle);
+    void wakeAll(BodyStorage& bodies);
+
+    // Awake islands found by the last update.
+    uint32_t getIslandCount() const;
+    size_t getSleepingIslandCount() const;
+
+    void save(SnapshotWriter& out) const;
+    bool load(SnapshotReader& in);
+    // After a load: every slot has its per-body state and every sleeping
+    // island member is a live, sleeping body of bodies.
+    bool isConsistentWith(const BodyStorage& bodies) const;
+
+private:
+    uint32_t findRoot(uint32_t i);
+    void wakeIsland(BodyStorage& bodies, uint32_t island);
+
+    bool enabled;
+    float sleepSpeed;
+    uint32_t sleepSteps;
+    uint32_t islandCount;
+    uint32_t nextIsland;
+    std::vector<uint32_t> parent;       // union-find over awake packed indices
+    std::vector<uint32_t> islandQuiet;  // smallest quiet count per root
+    std::vector<uint8_t> islandBlocked; // root touches a sleeping island
+    std::vector<uint32_t> islandId;     // sleeping island id per root
+    std::vector<uint32_t> wakeList;
+    std::vector<uint32_t> quietSteps;   // per handle slot
+    std::vector<uint32_t> slotIsland;   // per handle slot, valid while asleep
+    std::unordered_map<uint32_t, std::vector<BodyHandle>> sleeping;
+};
+
+#endif // ISLAND_MANAGER_H
@@ -0,0 +1,364 @@
+#include "Narrowphase.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Support mapping of the Minkowski difference of the two cores, A - B.
+struct MinkowskiDifference {
+    const Collider& a;
+    glm::vec3 positionA;
+    const Collider& b;
+    glm::vec3 positionB;
+
+    glm::vec3 support(const glm::vec3& direction) const {
+        return positionA + a.support(direction) - positionB - b.support(-direction);
+    }
+};
+
+struct Simplex {
+    glm::vec3 points[4];
+    int size = 0;
+};
+
+const int maxIterations = 64;
+
+glm::vec3 closestOnSegment(Simplex& s) {
+    glm::vec3 a = s.points[0];
+    glm::vec3 ab = s.points[1] - a;
+    float lengthSquared = glm::dot(ab, ab);
+    float t = lengthSquared > 0.0f ? -glm::dot(a, ab) / lengthSquared : 0.0f;
+    if (t <= 0.0f) {
+        s.size = 1;
+        return a;
+    }
+    if (t >= 1.0f) {
+        s.points[0] = s.points[1];
+        s.size = 1;
+        return s.points[0];
+    }
+    return a + ab * t;
+}
+
+// Closest point to the origin on a triangle, after Ericson's Real-Time
+// Collision Detection 5.1.5. The simplex is cut down to the feature the
+// point lies on.
+glm::vec3 closestOnTriangle(Simplex& s) {
+    glm::vec3 a = s.points[0];
+    glm::vec3 b = s.points[1];
+    glm::vec3 c = s.points[2];
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+
+    float d1 = glm::dot(ab, -a);
+    float d2 = glm::dot(ac, -a);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        s.size = 1;
+        return a;
+    }
+
+    float d3 = glm::dot(ab, -b);
+    float d4 = glm::dot(ac, -b);
+    if (d3 >= 0.0f && d4 <= d3) {
+        s.points[0] = b;
+        s.size = 1;
+        return b;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        s.size = 2;
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    float d5 = glm::dot(ab, -c);
+    float d6 = glm::dot(ac, -c);
+    if (d6 >= 0.0f && d5 <= d6) {
+        s.points[0] = c;
+        s.size = 1;
+        return c;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        s.points[1] = c;
+        s.size = 2;
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        s.points[0] = b;
+        s.points[1] = c;
+        s.size = 2;
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Returns false when the origin is inside the tetrahedron.
+bool closestOnTetrahedron(Simplex& s, glm::vec3& closest) {
+    static const int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+
+    float best = INFINITY;
+    Simplex bestSimplex;
+    for (const int* face : faces) {
+        glm::vec3 a = s.points[face[0]];
+        glm::vec3 n = glm::cross(s.points[face[1]] - a, s.points[face[2]] - a);
+        float originSide = glm::dot(-a, n);
+        float oppositeSide = glm::dot(s.points[face[3]] - a, n);
+        // A flat tetrahedron has no inside; search all of its faces.
+        if (originSide * oppositeSide < 0.0f || oppositeSide == 0.0f) {
+            Simplex triangle;
+            triangle.points[0] = a;
+            triangle.points[1] = s.points[face[1]];
+            triangle.points[2] = s.points[face[2]];
+            triangle.size = 3;
+            glm::vec3 p = closestOnTriangle(triangle);
+            if (glm::dot(p, p) < best) {
+                best = glm::dot(p, p);
+                closest = p;
+                bestSimplex = triangle;
+            }
+        }
+    }
+    if (best == INFINITY) {
+        return false;
+    }
+    s = bestSimplex;
+    return true;
+}
+
+// Returns true with the closest point of A - B to the origin while the cores
+// are apart, false once they touch or overlap.
+bool gjk(const MinkowskiDifference& m, Simplex& s, glm::vec3& closest) {
+    glm::vec3 v = m.positionA - m.positionB;
+    if (glm::dot(v, v) == 0.0f) {
+        v = glm::vec3(1.0f, 0.0f, 0.0f);
+    }
+    s.points[0] = m.support(-v);
+    s.size = 1;
+    v = s.points[0];
+
+    for (int iteration = 0; iteration < maxIterations; ++iteration) {
+        float lengthSquared = glm::dot(v, v);
+        if (lengthSquared < 1e-10f) {
+            return false;
+        }
+        glm::vec3 w = m.support(-v);
+        // No support point gets meaningfully closer: v is the answer.
+        bool repeated = false;
+        for (int i = 0; i < s.size; ++i) {
+            repeated = repeated || s.points[i] == w;
+        }
+        if (repeated || lengthSquared - glm::dot(v, w) <= 1e-5f * lengthSquared) {
+            closest = v;
+            return true;
+        }
+
+        s.points[s.size++] = w;
+        if (s.size == 2) {
+            v = closestOnSegment(s);
+        } else if (s.size == 3) {
+            v = closestOnTriangle(s);
+        } else if (!closestOnTetrahedron(s, v)) {
+            return false;
+        }
+    }
+    closest = v;
+    return true;
+}
+
+// Grows a touching simplex into a tetrahedron so EPA has a volume to expand.
+bool completeTetrahedron(const MinkowskiDifference& m, Simplex& s) {
+    static const glm::vec3 axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    const float epsilon = 1e-6f;
+
+    if (s.size == 1) {
+        for (const glm::vec3& axis : axes) {
+            glm::vec3 w = m.support(axis);
+            if (glm::length(w - s.points[0]) > epsilon) {
+                s.points[s.size++] = w;
+                break;
+            }
+        }
+    }
+    if (s.size == 2) {
+        glm::vec3 line = s.points[1] - s.points[0];
+        glm::vec3 absolute = glm::abs(line);
+        glm::vec3 axis = absolute.x < absolute.y ? (absolute.x < absolute.z ? axes[0] : axes[4])
+                                                 : (absolute.y < absolute.z ? axes[2] : axes[4]);
+        glm::vec3 side = glm::cross(line, axis);
+        glm::vec3 directions[4] = { side, -side, glm::cross(line, side), -glm::cross(line, side) };
+        for (const glm::vec3& direction : directions) {
+            glm::vec3 w = m.support(direction);
+            if (glm::length(glm::cross(w - s.points[0], line)) > epsilon * glm::length(line)) {
+                s.points[s.size++] = w;
+                break;
+            }
+        }
+    }
+    if (s.size == 3) {
+        glm::vec3 n = glm::cross(s.points[1] - s.points[0], s.points[2] - s.points[0]);
+        glm::vec3 w = m.support(n);
+        if (std::abs(glm::dot(w - s.points[0], n)) <= epsilon * glm::length(n)) {
+            w = m.support(-n);
+        }
+        if (std::abs(glm::dot(w - s.points[0], n)) > epsilon * glm::length(n)) {
+            s.points[s.size++] = w;
+        }
+    }
+    return s.size == 4;
+}
+
+struct Face {
+    int a, b, c;
+    glm::vec3 normal;
+    float distance;
+};
+
+bool makeFace(const std::vector<glm::vec3>& vertices, int a, int b, int c, Face& face) {
+    glm::vec3 n = glm::cross(vertices[b] - vertices[a], vertices[c] - vertices[a]);
+    float length = glm::length(n);
+    if (length < 1e-12f) {
+        return false;
+    }
+    face = { a, b, c, n / length, glm::dot(n / length, vertices[a]) };
+    return true;
+}
+
+// Expanding polytope: pushes the face of A - B nearest the origin outwards
+// until it is part of the hull. Its normal and distance are then the
+// separating direction and the core penetration.
+bool epa(const MinkowskiDifference& m, Simplex& s, glm::vec3& normal, float& depth) {
+    if (s.size < 4 && !completeTetrahedron(m, s)) {
+        return false;
+    }
+
+    std::vector<glm::vec3> vertices(s.points, s.points + 4);
+    std::vector<Face> faces;
+    glm::vec3 centre = (vertices[0] + vertices[1] + vertices[2] + vertices[3]) * 0.25f;
+    static const int tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+    for (const int* t : tetrahedron) {
+        Face face;
+        if (!makeFace(vertices, t[0], t[1], t[2], face)) {
+            return false;
+        }
+        // Wind every face away from the centre; later faces inherit it.
+        if (glm::dot(face.normal, vertices[t[0]] - centre) < 0.0f) {
+            makeFace(vertices, t[0], t[2], t[1], face);
+        }
+        faces.push_back(face);
+    }
+
+    std::vector<std::pair<int, int>> horizon;
+    for (int iteration = 0; iteration < maxIterations; ++iteration) {
+        size_t nearest = 0;
+        for (size_t i = 1; i < faces.size(); ++i) {
+            if (faces[i].distance < faces[nearest].distance) {
+                nearest = i;
+            }
+        }
+        const Face& closest = faces[nearest];
+        glm::vec3 w = m.support(closest.normal);
+        if (glm::dot(w, closest.normal) - closest.distance < 1e-4f || iteration == maxIterations - 1) {
+            normal = -closest.normal;
+            depth = closest.distance;
+            return true;
+        }
+
+        int index = static_cast<int>(vertices.size());
+        vertices.push_back(w);
+
+        // Drop every face the new point sees; the edges they don't share
+        // form the horizon to fan the new faces from.
+        horizon.clear();
+        for (size_t i = faces.size(); i-- > 0;) {
+            const Face& face = faces[i];
+            if (glm::dot(face.normal, w - vertices[face.a]) <= 0.0f) {
+                continue;
+            }
+            int edges[3][2] = { { face.a, face.b }, { face.b, face.c }, { face.c, face.a } };
+            for (const int* edge : edges) {
+                auto shared = std::find(horizon.begin(), horizon.end(), std::make_pair(edge[1], edge[0]));
+                if (shared != horizon.end()) {
+                    horizon.erase(shared);
+                } else {
+                    horizon.emplace_back(edge[0], edge[1]);
+                }
+            }
+            faces[i] = faces.back();
+            faces.pop_back();
+        }
+        for (const std::pair<int, int>& edge : horizon) {
+            Face face;
+            if (makeFace(vertices, edge.first, edge.second, index, face)) {
+                faces.push_back(face);
+            }
+        }
+        if (faces.empty()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool collideShapes(const Collider& shapeA, const glm::vec3& positionA,
+                   const Collider& shapeB, const glm::vec3& positionB,
+                   float margin, glm::vec3& normal, float& depth) {
+    if (shapeB.getType() == ColliderType::Plane) {
+        if (shapeA.getType() == ColliderType::Plane) {
+            return false;
+        }
+        const glm::vec3& n = shapeB.getNormal();
+        glm::vec3 deepest = positionA + shapeA.support(-n);
+        normal = n;
+        depth = shapeA.getRadius() - glm::dot(deepest - positionB, n);
+        return depth > -margin;
+    }
+    if (shapeA.getType() == ColliderType::Plane) {
+        bool touching = collideShapes(shapeB, positionB, shapeA, positionA, margin, normal, depth);
+        normal = -normal;
+        return touching;
+    }
+
+    glm::vec3 delta = positionA - positionB;
+    float reach = shapeA.getBoundingRadius() + shapeB.getBoundingRadius() + margin;
+    if (glm::dot(delta, delta) >= reach * reach) {
+        return false;
+    }
+
+    float radiusSum = shapeA.getRadius() + shapeB.getRadius();
+    if (shapeA.getType() == ColliderType::Sphere && shapeB.getType() == ColliderType::Sphere) {
+        float distance = glm::length(delta);
+        normal = distance > 0.0f ? delta / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+        depth = radiusSum - distance;
+        return depth > -margin;
+    }
+
+    MinkowskiDifference m = { shapeA, positionA, shapeB, positionB };
+    Simplex s;
+    glm::vec3 closest;
+    if (gjk(m, s, closest)) {
+        float distance = glm::length(closest);
+        depth = radiusSum - distance;
+        normal = closest / distance;
+        return depth > -margin;
+    }
+
+    float coreDepth;
+    if (!epa(m, s, normal, coreDepth)) {
+        // Degenerate overlap, e.g. two flat hulls: fall back to the centres.
+        float distance = glm::length(delta);
+        normal = distance > 0.0f ? delta / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+        coreDepth = 0.0f;
+    }
+    depth = coreDepth + radiusSum;
+    return true;
+}
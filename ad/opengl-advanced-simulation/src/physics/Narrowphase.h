@@ -0,0 +1,18 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <glm/glm.hpp>
+#include "Collider.h"
+
+// Contact between two colliders placed at the given positions. normal points
+// from b towards a and depth is the penetration, negative for a gap. Returns
+// false once the gap is wider than margin.
+//
+// Sphere pairs and anything against a plane are solved analytically. The
+// rest go through GJK on the core shapes, which gives the gap directly while
+// they are apart; once the cores overlap EPA finds the penetration.
+bool collideShapes(const Collider& shapeA, const glm::vec3& positionA,
+                   const Collider& shapeB, const glm::vec3& positionB,
+                   float margin, glm::vec3& normal, float& depth);
+
+#endif // NARROWPHASE_H
@@ -1,38 +1,1063 @@
 #include "PhysicsEngine.h"
-#include "RigidBody.h"
-#include <vector>
+#include "Narrowphase.h"
+#include "SpatialHashBroadphase.h"
+#include "SweepAndPrune.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
-class PhysicsEngine {
-public:
-    PhysicsEngine();
-    ~PhysicsEngine();
+PhysicsEngine::PhysicsEngine()
+    : verletBroadphase(nullptr), broadphaseType(BroadphaseType::SpatialHash), broadphaseCellSize(0.0f), broadphaseSkin(0.0f),
+      jobSystem(nullptr), gravity(0.0f), hasWorldBounds(false),
+      continuousCollision(true), ccdThreshold(0.5f), deterministic(false), stepCount(0), randomSeed(0),
+      reorderInterval(0), reorderCount(0), mutualStrength(0.0f), mutualSoftening(0.1f) {
+    setBroadphase(BroadphaseType::SpatialHash);
+}
+
+PhysicsEngine::~PhysicsEngine() {}
+
+// Bodies per job. A multiple of 8 so SIMD kernels only see full vectors
+// except in the last chunk.
+static const uint32_t bodiesPerJob = 4096;
+static const uint32_t pairsPerJob = 2048;
+// Pairs closer than this get a speculative contact, so the solver keeps
+// supporting resting bodies instead of losing the contact every other step.
+static const float contactMargin = 0.02f;
+
+// World bounds of body i's collider placed at position, grown by padding.
+static AABB colliderBounds(const BodyStorage& bodies, uint32_t i, const glm::vec3& position, float padding) {
+    if (bodies.collider[i].getType() == ColliderType::Sphere) {
+        return AABB::fromSphere(position, bodies.radius[i] + padding);
+    }
+    AABB bounds = bodies.collider[i].bounds(position);
+    return AABB(bounds.min - glm::vec3(padding), bounds.max + glm::vec3(padding));
+}
+
+static bool isPlane(const BodyStorage& bodies, uint32_t i) {
+    return bodies.collider[i].getType() == ColliderType::Plane;
+}
+
+void PhysicsEngine::update(float deltaTime) {
+    ++stepCount;
+    profiler.beginStep(stepCount);
+    if (reorderInterval > 0 && stepCount % reorderInterval == 0) {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::Reorder);
+        reorderBodies();
+    }
+    uint32_t count = bodies.size();
+    uint32_t awake = bodies.awakeCount();
+    if (awake == 0) {
+        // Everything is asleep: nothing can move until something wakes it.
+        candidatePairs.clear();
+        contacts.clear();
+        fastBodies.clear();
+        recordProfile(0, false);
+        return;
+    }
+    bodyBounds.resize(count);
+    fastBodies.assign(count, 0);
+
+    if (mutualStrength != 0.0f) {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::LongRangeForces);
+        applyMutualForces();
+    }
+
+    {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::Integrate);
+        parallelFor(jobSystem, awake, bodiesPerJob, [&](uint32_t begin, uint32_t end) {
+            std::copy(bodies.positionX.begin() + begin, bodies.positionX.begin() + end, bodies.previousX.begin() + begin);
+            std::copy(bodies.positionY.begin() + begin, bodies.positionY.begin() + end, bodies.previousY.begin() + begin);
+            std::copy(bodies.positionZ.begin() + begin, bodies.positionZ.begin() + end, bodies.previousZ.begin() + begin);
+            integrator.integrate(bodies, gravity, deltaTime, begin, end);
+            for (uint32_t i = begin; i < end; ++i) {
+                bodyBounds[i] = colliderBounds(bodies, i, bodies.position(i), 0.5f * contactMargin);
+
+                // Fast bodies get bounds over their whole path so the broadphase
+                // also returns whatever they passed through.
+                glm::vec3 motion = bodies.position(i) - bodies.previousPosition(i);
+                float limit = ccdThreshold * bodies.radius[i];
+                fastBodies[i] = continuousCollision && glm::dot(motion, motion) > limit * limit;
+                if (fastBodies[i]) {
+                    bodyBounds[i] = bodyBounds[i].merged(colliderBounds(bodies, i, bodies.previousPosition(i), 0.5f * contactMargin));
+                }
+            }
+        });
+        // Sleeping bodies don't move, but awake ones can still run into them.
+        for (uint32_t i = awake; i < count; ++i) {
+            bodyBounds[i] = colliderBounds(bodies, i, bodies.position(i), 0.5f * contactMargin);
+        }
+    }
+
+    {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::Broadphase);
+        if (planes.empty()) {
+            broadphase->findPairs(bodyBounds, candidatePairs);
+        } else {
+            // Planes have no bounds, so the broadphase only sees the other
+            // bodies packed together and their pairs are mapped back.
+            broadphaseBodies.clear();
+            broadphaseBounds.clear();
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!isPlane(bodies, i)) {
+                    broadphaseBodies.push_back(i);
+                    broadphaseBounds.push_back(bodyBounds[i]);
+                }
+            }
+            broadphase->findPairs(broadphaseBounds, candidatePairs);
+            for (BroadphasePair& pair : candidatePairs) {
+                pair.a = broadphaseBodies[pair.a];
+                pair.b = broadphaseBodies[pair.b];
+            }
+        }
+        if (deterministic) {
+            for (BroadphasePair& pair : candidatePairs) {
+                if (pair.a > pair.b) {
+                    std::swap(pair.a, pair.b);
+                }
+            }
+            std::sort(candidatePairs.begin(), candidatePairs.end(), [](const BroadphasePair& x, const BroadphasePair& y) {
+                return x.a != y.a ? x.a < y.a : x.b < y.b;
+            });
+        }
+    }
+    if (continuousCollision) {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::ContinuousCollision);
+        sweepFastBodies();
+    }
+    uint32_t pairsTested;
+    {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::Narrowphase);
+        pairsTested = findContacts();
+    }
+    {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::Solver);
+        solver.solve(bodies, contacts, deltaTime);
+    }
+    {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::QueryTree);
+        updateQueryTree(deltaTime);
+    }
+    {
+        PhysicsProfiler::Scope scope(profiler, PhysicsPhase::Islands);
+        if (islands.update(bodies, contacts)) {
+            broadphase->invalidate();
+        }
+    }
+    recordProfile(pairsTested, true);
+}
+
+void PhysicsEngine::recordProfile(uint32_t pairsTested, bool broadphaseRan) {
+    if (!profiler.isEnabled()) {
+        return;
+    }
+    StepProfile& profile = profiler.current();
+    profile.bodies = bodies.size();
+    profile.awakeBodies = bodies.awakeCount();
+    profile.sleepingBodies = profile.bodies - profile.awakeBodies;
+    profile.fastBodies = static_cast<uint32_t>(std::count(fastBodies.begin(), fastBodies.end(), 1));
+    profile.candidatePairs = static_cast<uint32_t>(candidatePairs.size());
+    profile.broadphaseRebuilds = broadphaseRan && (!verletBroadphase || verletBroadphase->rebuiltLastCall());
+    profile.pairsTested = pairsTested;
+    profile.contacts = static_cast<uint32_t>(contacts.size());
+    profile.manifolds = static_cast<uint32_t>(solver.getManifoldCount());
+    profile.solverIterations = contacts.empty() ? 0 : static_cast<uint32_t>(solver.getIterations());
+    profile.islands = islands.getIslandCount();
+    profile.sleepingIslands = static_cast<uint32_t>(islands.getSleepingIslandCount());
+    profiler.endStep();
+}
+
+// Fraction of the step at which two spheres moving linearly from their start
+// to their end positions first touch, or 1 if they don't. Pairs that already
+// overlap at the start are left to the discrete contacts.
+static float sphereTimeOfImpact(const glm::vec3& start, const glm::vec3& motion, float radius) {
+    float c = glm::dot(start, start) - radius * radius;
+    float b = glm::dot(start, motion);
+    float a = glm::dot(motion, motion);
+    if (c <= 0.0f || b >= 0.0f || a == 0.0f) {
+        return 1.0f;
+    }
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f) {
+        return 1.0f;
+    }
+    return std::min((-b - std::sqrt(discriminant)) / a, 1.0f);
+}
+
+// Same for any two colliders, by conservative advancement: the gap measured
+// along the current normal can shrink no faster than the relative motion
+// along it, so stepping by gap over closing speed never passes through.
+// Stops with a gap of at most tolerance, close enough for the discrete
+// contacts to catch. Pairs already that close at the start are left to the
+// discrete contacts too.
+static float shapeTimeOfImpact(const Collider& shapeA, const glm::vec3& startA, const glm::vec3& motionA,
+                               const Collider& shapeB, const glm::vec3& startB, const glm::vec3& motionB,
+                               float tolerance) {
+    glm::vec3 motion = motionA - motionB;
+    float t = 0.0f;
+    for (int iteration = 0; iteration < 32; ++iteration) {
+        glm::vec3 normal;
+        float depth;
+        collideShapes(shapeA, startA + motionA * t, shapeB, startB + motionB * t, INFINITY, normal, depth);
+        if (-depth <= tolerance) {
+            return t == 0.0f ? 1.0f : t;
+        }
+        float closing = -glm::dot(motion, normal);
+        if (closing <= 0.0f) {
+            return 1.0f;
+        }
+        // Aim for half the tolerance so the gap stays positive.
+        t += (-depth - 0.5f * tolerance) / closing;
+        if (t >= 1.0f) {
+            return 1.0f;
+        }
+    }
+    return t;
+}
+
+void PhysicsEngine::sweepFastBodies() {
+    // Pull every fast body back to its first time of impact along the step,
+    // against both other bodies and the world box. The contacts found right
+    // after that then let the solver stop or bounce it at the surface. Only
+    // the fast body moves back; whatever it hit keeps its own motion. Pairs
+    // of spheres are solved exactly, any other pair by conservative
+    // advancement on the real shapes.
+    uint32_t count = bodies.size();
+    impactTimes.assign(count, 1.0f);
+    bool anyFast = false;
+    for (uint32_t i = 0; i < count && !anyFast; ++i) {
+        anyFast = fastBodies[i] != 0;
+    }
+    if (!anyFast) {
+        return;
+    }
+
+    for (const BroadphasePair& pair : candidatePairs) {
+        if (!fastBodies[pair.a] && !fastBodies[pair.b]) {
+            continue;
+        }
+        glm::vec3 startA = bodies.previousPosition(pair.a);
+        glm::vec3 startB = bodies.previousPosition(pair.b);
+        glm::vec3 motionA = bodies.position(pair.a) - startA;
+        glm::vec3 motionB = bodies.position(pair.b) - startB;
+        float t;
+        if (bodies.collider[pair.a].getType() == ColliderType::Sphere &&
+            bodies.collider[pair.b].getType() == ColliderType::Sphere) {
+            t = sphereTimeOfImpact(startA - startB, motionA - motionB, bodies.radius[pair.a] + bodies.radius[pair.b]);
+        } else {
+            t = shapeTimeOfImpact(bodies.collider[pair.a], startA, motionA, bodies.collider[pair.b], startB, motionB,
+                                  contactMargin);
+        }
+        impactTimes[pair.a] = std::min(impactTimes[pair.a], t);
+        impactTimes[pair.b] = std::min(impactTimes[pair.b], t);
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!fastBodies[i]) {
+            continue;
+        }
+        glm::vec3 start = bodies.previousPosition(i);
+        glm::vec3 end = bodies.position(i);
+        if (hasWorldBounds) {
+            // Time at which the collider surface reaches each face it crosses.
+            AABB extent = colliderBounds(bodies, i, glm::vec3(0.0f), 0.0f);
+            for (int axis = 0; axis < 3; ++axis) {
+                float low = worldBounds.min[axis] - extent.min[axis];
+                float high = worldBounds.max[axis] - extent.max[axis];
+                if (end[axis] < low && start[axis] >= low) {
+                    impactTimes[i] = std::min(impactTimes[i], (start[axis] - low) / (start[axis] - end[axis]));
+                } else if (end[axis] > high && start[axis] <= high) {
+                    impactTimes[i] = std::min(impactTimes[i], (high - start[axis]) / (end[axis] - start[axis]));
+                }
+            }
+        }
+        if (impactTimes[i] < 1.0f) {
+            bodies.setPosition(i, glm::mix(start, end, impactTimes[i]));
+        }
+    }
+}
+
+void PhysicsEngine::findBoundsContacts() {
+    // The inside faces of the world box act as static planes in the solver,
+    // so resting bodies are supported by the same iterations as a stack.
+    uint32_t count = bodies.awakeCount();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (isPlane(bodies, i)) {
+            continue;
+        }
+        AABB bounds = colliderBounds(bodies, i, bodies.position(i), 0.0f);
+        for (int axis = 0; axis < 3; ++axis) {
+            float below = worldBounds.min[axis] - bounds.min[axis];
+            float above = bounds.max[axis] - worldBounds.max[axis];
+            glm::vec3 normal(0.0f);
+            if (below > -contactMargin) {
+                normal[axis] = 1.0f;
+                contacts.push_back({ i, Contact::world, normal, below, static_cast<uint32_t>(axis * 2) });
+            } else if (above > -contactMargin) {
+                normal[axis] = -1.0f;
+                contacts.push_back({ i, Contact::world, normal, above, static_cast<uint32_t>(axis * 2 + 1) });
+            }
+        }
+    }
+}
+
+uint32_t PhysicsEngine::findPlaneContacts() {
+    // Planes stay out of the broadphase, so every awake body is tested
+    // against each of them directly; there are only ever a handful.
+    uint32_t count = bodies.awakeCount();
+    uint32_t tests = 0;
+    for (BodyHandle handle : planes) {
+        uint32_t p = bodies.denseIndex(handle);
+        for (uint32_t i = 0; i < count; ++i) {
+            glm::vec3 normal;
+            float depth;
+            if (isPlane(bodies, i)) {
+                continue;
+            }
+            ++tests;
+            if (collideShapes(bodies.collider[i], bodies.position(i), bodies.collider[p], bodies.position(p),
+                              contactMargin, normal, depth)) {
+                contacts.push_back({ i, p, normal, depth });
+            }
+        }
+    }
+    return tests;
+}
+
+// Narrowphase outcome per candidate pair.
+static const uint8_t pairSkipped = 0;
+static const uint8_t pairSeparate = 1;
+static const uint8_t pairTouching = 2;
+
+uint32_t PhysicsEngine::findContacts() {
+    // Each pair writes only its own slot, then the touching ones are packed
+    // in pair order.
+    uint32_t pairCount = static_cast<uint32_t>(candidatePairs.size());
+    pairContacts.resize(pairCount);
+    pairResults.resize(pairCount);
+
+    parallelFor(jobSystem, pairCount, pairsPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; ++k) {
+            uint32_t a = candidatePairs[k].a;
+            uint32_t b = candidatePairs[k].b;
+            if (!bodies.isAwake(a) && !bodies.isAwake(b)) {
+                pairResults[k] = pairSkipped;
+                continue;
+            }
+
+            ColliderType typeA = bodies.collider[a].getType();
+            ColliderType typeB = bodies.collider[b].getType();
+            if (typeA == ColliderType::Sphere && typeB == ColliderType::Sphere) {
+                glm::vec3 delta = bodies.position(a) - bodies.position(b);
+                float radiusSum = bodies.radius[a] + bodies.radius[b];
+                float reach = radiusSum + contactMargin;
+                float distanceSquared = glm::dot(delta, delta);
+                bool touching = distanceSquared < reach * reach && distanceSquared > 0.0f;
+                pairResults[k] = touching ? pairTouching : pairSeparate;
+                if (touching) {
+                    float distance = std::sqrt(distanceSquared);
+                    pairContacts[k] = { a, b, delta / distance, radiusSum - distance };
+                }
+            } else {
+                glm::vec3 normal;
+                float depth;
+                bool touching = collideShapes(bodies.collider[a], bodies.position(a), bodies.collider[b],
+                                              bodies.position(b), contactMargin, normal, depth);
+                pairResults[k] = touching ? pairTouching : pairSeparate;
+                if (touching) {
+                    pairContacts[k] = { a, b, normal, depth };
+                }
+            }
+        }
+    });
+
+    contacts.clear();
+    if (hasWorldBounds) {
+        findBoundsContacts();
+    }
+    uint32_t tests = findPlaneContacts();
+    for (uint32_t k = 0; k < pairCount; ++k) {
+        tests += pairResults[k] != pairSkipped;
+        if (pairResults[k] == pairTouching) {
+            contacts.push_back(pairContacts[k]);
+        }
+    }
+    return tests;
+}
 
-    void Update(float deltaTime);
-    void AddRigidBody(RigidBody* body);
-    void RemoveRigidBody(RigidBody* body);
+void PhysicsEngine::updateQueryTree(float deltaTime) {
+    uint32_t count = bodies.awakeCount();
+    for (uint32_t i = 0; i < count; ++i) {
+        int proxy = slotProxies[bodies.handleAt(i).index];
+        if (proxy != DynamicAABBTree::nullNode) {
+            queryTree.moveProxy(proxy, colliderBounds(bodies, i, bodies.position(i), 0.0f), bodies.velocity(i) * deltaTime);
+        }
+    }
+}
+
+void PhysicsEngine::applyMutualForces() {
+    // Static bodies have no mass to attract with, so they are left out.
+    uint32_t count = bodies.size();
+    bodyMass.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        bodyMass[i] = bodies.inverseMass[i] > 0.0f ? 1.0f / bodies.inverseMass[i] : 0.0f;
+    }
+    longRangeTree.build(bodies.positionX.data(), bodies.positionY.data(), bodies.positionZ.data(), bodyMass.data(), count);
+
+    longRangeTree.computeFields(mutualSoftening, count, longRangeFields);
+
+    // Sleeping bodies still pull on awake ones but don't get a force until
+    // something wakes them.
+    parallelFor(jobSystem, bodies.awakeCount(), bodiesPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            bodies.addForce(i, longRangeFields[i] * (mutualStrength * bodyMass[i]));
+        }
+    });
+}
+
+void PhysicsEngine::setMutualForce(float strength, float softening) {
+    mutualStrength = strength;
+    mutualSoftening = std::max(softening, 0.0f);
+    wakeAll();
+}
+
+float PhysicsEngine::getMutualForceStrength() const {
+    return mutualStrength;
+}
+
+float PhysicsEngine::getMutualForceSoftening() const {
+    return mutualSoftening;
+}
+
+void PhysicsEngine::setBarnesHutTheta(float theta) {
+    longRangeTree.setTheta(theta);
+}
+
+float PhysicsEngine::getBarnesHutTheta() const {
+    return longRangeTree.getTheta();
+}
+
+// Spreads the low 10 bits of v so that two zero bits follow each one.
+static uint32_t spreadBits(uint32_t v) {
+    v &= 0x3ffu;
+    v = (v | (v << 16)) & 0x030000ffu;
+    v = (v | (v << 8)) & 0x0300f00fu;
+    v = (v | (v << 4)) & 0x030c30c3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+void PhysicsEngine::reorderBodies() {
+    uint32_t count = bodies.size();
+    if (count < 2) {
+        return;
+    }
+
+    // Quantize to a 1024^3 grid over the bodies' extent. Planes sit at an
+    // arbitrary point, so they stay out of the extent and are clamped.
+    glm::vec3 low(INFINITY), high(-INFINITY);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!isPlane(bodies, i)) {
+            low = glm::min(low, bodies.position(i));
+            high = glm::max(high, bodies.position(i));
+        }
+    }
+    if (low.x > high.x) {
+        return;
+    }
+    glm::vec3 scale = 1023.0f / glm::max(high - low, glm::vec3(1e-6f));
+
+    // Key is the Morton code above the current index, which breaks ties the
+    // same way every time.
+    mortonKeys.resize(count);
+    parallelFor(jobSystem, count, bodiesPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            glm::vec3 cell = glm::clamp((bodies.position(i) - low) * scale, glm::vec3(0.0f), glm::vec3(1023.0f));
+            uint32_t code = spreadBits(static_cast<uint32_t>(cell.x)) |
+                            spreadBits(static_cast<uint32_t>(cell.y)) << 1 |
+                            spreadBits(static_cast<uint32_t>(cell.z)) << 2;
+            mortonKeys[i] = static_cast<uint64_t>(code) << 32 | i;
+        }
+    });
+    uint32_t awake = bodies.awakeCount();
+    std::sort(mortonKeys.begin(), mortonKeys.begin() + awake);
+    std::sort(mortonKeys.begin() + awake, mortonKeys.end());
+
+    std::vector<uint32_t> order(count);
+    reorderRemap.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        order[i] = static_cast<uint32_t>(mortonKeys[i]);
+        reorderRemap[order[i]] = i;
+    }
+    bodies.permute(order);
+    // Cached pairs and contacts are by packed index.
+    broadphase->invalidate();
+    candidatePairs.clear();
+    contacts.clear();
+    ++reorderCount;
+}
 
-private:
-    std::vector<RigidBody*> rigidBodies;
-};
+void PhysicsEngine::setReorderInterval(uint32_t steps) {
+    reorderInterval = steps;
+}
+
+uint32_t PhysicsEngine::getReorderInterval() const {
+    return reorderInterval;
+}
+
+uint64_t PhysicsEngine::getReorderCount() const {
+    return reorderCount;
+}
+
+const std::vector<uint32_t>& PhysicsEngine::getReorderRemap() const {
+    return reorderRemap;
+}
+
+// The tree stores the slot index as user data so that swap-removal never has
+// to touch it.
+static uint32_t proxySlot(const DynamicAABBTree& tree, int proxyId) {
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(tree.getUserData(proxyId)));
+}
+
+static bool shapesOverlap(const Collider& shapeA, const glm::vec3& positionA,
+                          const Collider& shapeB, const glm::vec3& positionB) {
+    glm::vec3 normal;
+    float depth;
+    return collideShapes(shapeA, positionA, shapeB, positionB, 0.0f, normal, depth);
+}
+
+// Conservative advancement: step along the ray by the current gap, which can
+// never skip past the surface, until the gap closes.
+static bool raycastShape(const Collider& shape, const glm::vec3& position, const glm::vec3& origin,
+                         const glm::vec3& direction, float maxDistance, float& distance, glm::vec3& normal) {
+    static const Collider point = Collider::sphere(0.0f);
+    distance = 0.0f;
+    for (int iteration = 0; iteration < 32; ++iteration) {
+        float depth;
+        collideShapes(point, origin + direction * distance, shape, position, INFINITY, normal, depth);
+        if (depth > -1e-4f) {
+            if (distance == 0.0f && depth > 0.0f) {
+                normal = -direction;
+            }
+            return true;
+        }
+        distance -= depth;
+        if (distance > maxDistance) {
+            return false;
+        }
+    }
+    return false;
+}
 
-PhysicsEngine::PhysicsEngine() {}
+bool PhysicsEngine::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+    bool found = false;
+    queryTree.raycast(origin, direction, maxDistance, [&](int proxyId, float closest) {
+        uint32_t i = bodies.denseIndex(bodies.handleForSlot(proxySlot(queryTree, proxyId)));
+        glm::vec3 center = bodies.position(i);
+        float distance;
+        glm::vec3 normal;
 
-PhysicsEngine::~PhysicsEngine() {
-    for (auto body : rigidBodies) {
-        delete body;
+        if (bodies.collider[i].getType() == ColliderType::Sphere) {
+            // Ray against sphere, keeping the nearest entry point.
+            glm::vec3 toCenter = origin - center;
+            float radius = bodies.radius[i];
+            float b = glm::dot(toCenter, direction);
+            float c = glm::dot(toCenter, toCenter) - radius * radius;
+            float discriminant = b * b - c;
+            // Outside and pointing away, or never reaching the surface.
+            if ((c > 0.0f && b > 0.0f) || discriminant < 0.0f) {
+                return closest;
+            }
+            // From inside the ray hits at once, like raycastShape.
+            distance = c > 0.0f ? -b - std::sqrt(discriminant) : 0.0f;
+            normal = c > 0.0f ? glm::normalize(origin + direction * distance - center) : -direction;
+        } else if (!raycastShape(bodies.collider[i], center, origin, direction, closest, distance, normal)) {
+            return closest;
+        }
+        if (distance > closest) {
+            return closest;
+        }
+
+        hit.body = bodies.handleAt(i);
+        hit.distance = distance;
+        hit.point = origin + direction * distance;
+        hit.normal = normal;
+        found = true;
+        return distance;
+    });
+
+    float closest = found ? hit.distance : maxDistance;
+    for (BodyHandle handle : planes) {
+        uint32_t p = bodies.denseIndex(handle);
+        const glm::vec3& normal = bodies.collider[p].getNormal();
+        float height = glm::dot(origin - bodies.position(p), normal);
+        float speed = glm::dot(direction, normal);
+        float distance = height <= 0.0f ? 0.0f : (speed < 0.0f ? -height / speed : INFINITY);
+        if (distance <= closest) {
+            closest = distance;
+            hit.body = handle;
+            hit.distance = distance;
+            hit.point = origin + direction * distance;
+            hit.normal = height <= 0.0f ? -direction : normal;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void PhysicsEngine::overlapSphere(const glm::vec3& center, float radius, std::vector<BodyHandle>& results) const {
+    results.clear();
+    Collider sphere = Collider::sphere(radius);
+    queryTree.query(AABB::fromSphere(center, radius), [&](int proxyId) {
+        uint32_t i = bodies.denseIndex(bodies.handleForSlot(proxySlot(queryTree, proxyId)));
+        bool overlapping;
+        if (bodies.collider[i].getType() == ColliderType::Sphere) {
+            float reach = radius + bodies.radius[i];
+            glm::vec3 delta = bodies.position(i) - center;
+            overlapping = glm::dot(delta, delta) <= reach * reach;
+        } else {
+            overlapping = shapesOverlap(bodies.collider[i], bodies.position(i), sphere, center);
+        }
+        if (overlapping) {
+            results.push_back(bodies.handleAt(i));
+        }
+        return true;
+    });
+    for (BodyHandle handle : planes) {
+        uint32_t p = bodies.denseIndex(handle);
+        if (shapesOverlap(sphere, center, bodies.collider[p], bodies.position(p))) {
+            results.push_back(handle);
+        }
+    }
+}
+
+void PhysicsEngine::overlapBox(const AABB& box, std::vector<BodyHandle>& results) const {
+    results.clear();
+    Collider boxShape = Collider::box(box.extents() * 0.5f);
+    glm::vec3 boxCenter = (box.min + box.max) * 0.5f;
+    queryTree.query(box, [&](int proxyId) {
+        uint32_t i = bodies.denseIndex(bodies.handleForSlot(proxySlot(queryTree, proxyId)));
+        glm::vec3 position = bodies.position(i);
+        bool overlapping;
+        if (bodies.collider[i].getType() == ColliderType::Sphere) {
+            glm::vec3 delta = position - glm::clamp(position, box.min, box.max);
+            overlapping = glm::dot(delta, delta) <= bodies.radius[i] * bodies.radius[i];
+        } else {
+            overlapping = shapesOverlap(bodies.collider[i], position, boxShape, boxCenter);
+        }
+        if (overlapping) {
+            results.push_back(bodies.handleAt(i));
+        }
+        return true;
+    });
+    for (BodyHandle handle : planes) {
+        uint32_t p = bodies.denseIndex(handle);
+        if (shapesOverlap(boxShape, boxCenter, bodies.collider[p], bodies.position(p))) {
+            results.push_back(handle);
+        }
     }
 }
 
-void PhysicsEngine::Update(float deltaTime) {
-    for (auto body : rigidBodies) {
-        body->Update(deltaTime);
+BodyHandle PhysicsEngine::addRigidBody(const RigidBody& body) {
+    BodyHandle handle = bodies.create(body);
+    if (slotProxies.size() <= handle.index) {
+        slotProxies.resize(handle.index + 1, DynamicAABBTree::nullNode);
+    }
+    if (body.getCollider().getType() == ColliderType::Plane) {
+        // Unbounded, so neither the broadphase nor the query tree can hold it.
+        planes.push_back(handle);
+    } else {
+        void* userData = reinterpret_cast<void*>(static_cast<uintptr_t>(handle.index));
+        slotProxies[handle.index] = queryTree.createProxy(body.getCollider().bounds(body.getPosition()), userData);
     }
+    islands.addBody(handle);
+    broadphase->invalidate();
+    return handle;
 }
 
-void PhysicsEngine::AddRigidBody(RigidBody* body) {
-    rigidBodies.push_back(body);
+void PhysicsEngine::removeRigidBody(BodyHandle handle) {
+    if (!bodies.isValid(handle)) {
+        return;
+    }
+    // Whatever was resting on the body has to notice it's gone.
+    islands.wake(bodies, handle);
+    if (slotProxies[handle.index] != DynamicAABBTree::nullNode) {
+        queryTree.destroyProxy(slotProxies[handle.index]);
+        slotProxies[handle.index] = DynamicAABBTree::nullNode;
+    }
+    planes.erase(std::remove(planes.begin(), planes.end(), handle), planes.end());
+    bodies.destroy(handle);
+    broadphase->invalidate();
 }
 
-void PhysicsEngine::RemoveRigidBody(RigidBody* body) {
-    rigidBodies.erase(std::remove(rigidBodies.begin(), rigidBodies.end(), body), rigidBodies.end());
-}
\ No newline at end of file
+bool PhysicsEngine::isValid(BodyHandle handle) const {
+    return bodies.isValid(handle);
+}
+
+void PhysicsEngine::applyForce(BodyHandle handle, const glm::vec3& force) {
+    if (bodies.isValid(handle)) {
+        wakeBody(handle);
+        bodies.addForce(bodies.denseIndex(handle), force);
+    }
+}
+
+void PhysicsEngine::setPosition(BodyHandle handle, const glm::vec3& position) {
+    if (bodies.isValid(handle)) {
+        wakeBody(handle);
+        // A teleport shouldn't be smeared across the interpolated frames.
+        bodies.setPosition(bodies.denseIndex(handle), position);
+        bodies.setPreviousPosition(bodies.denseIndex(handle), position);
+    }
+}
+
+void PhysicsEngine::setVelocity(BodyHandle handle, const glm::vec3& velocity) {
+    if (bodies.isValid(handle)) {
+        wakeBody(handle);
+        bodies.setVelocity(bodies.denseIndex(handle), velocity);
+    }
+}
+
+glm::vec3 PhysicsEngine::getPosition(BodyHandle handle) const {
+    return bodies.isValid(handle) ? bodies.position(bodies.denseIndex(handle)) : glm::vec3(0.0f);
+}
+
+glm::vec3 PhysicsEngine::getInterpolatedPosition(BodyHandle handle, float alpha) const {
+    if (!bodies.isValid(handle)) {
+        return glm::vec3(0.0f);
+    }
+    uint32_t i = bodies.denseIndex(handle);
+    return glm::mix(bodies.previousPosition(i), bodies.position(i), alpha);
+}
+
+void PhysicsEngine::getInterpolatedPositions(float alpha, std::vector<glm::vec3>& positions) const {
+    uint32_t count = bodies.size();
+    positions.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        positions[i] = glm::mix(bodies.previousPosition(i), bodies.position(i), alpha);
+    }
+}
+
+glm::vec3 PhysicsEngine::getVelocity(BodyHandle handle) const {
+    return bodies.isValid(handle) ? bodies.velocity(bodies.denseIndex(handle)) : glm::vec3(0.0f);
+}
+
+const Collider& PhysicsEngine::getCollider(BodyHandle handle) const {
+    static const Collider none = Collider::sphere(0.0f);
+    return bodies.isValid(handle) ? bodies.collider[bodies.denseIndex(handle)] : none;
+}
+
+bool PhysicsEngine::isAwake(BodyHandle handle) const {
+    return bodies.isValid(handle) && bodies.isAwake(bodies.denseIndex(handle));
+}
+
+void PhysicsEngine::wakeBody(BodyHandle handle) {
+    bool wasAsleep = isValid(handle) && !isAwake(handle);
+    islands.wake(bodies, handle);
+    if (wasAsleep) {
+        broadphase->invalidate();
+    }
+}
+
+float PhysicsEngine::getRadius(BodyHandle handle) const {
+    return bodies.isValid(handle) ? bodies.radius[bodies.denseIndex(handle)] : 0.0f;
+}
+
+uint32_t PhysicsEngine::getBodyCount() const {
+    return bodies.size();
+}
+
+uint32_t PhysicsEngine::getAwakeBodyCount() const {
+    return bodies.awakeCount();
+}
+
+const BodyStorage& PhysicsEngine::getBodies() const {
+    return bodies;
+}
+
+void PhysicsEngine::setJobSystem(JobSystem* jobs) {
+    jobSystem = jobs;
+    broadphase->setJobSystem(jobs);
+    longRangeTree.setJobSystem(jobs);
+}
+
+void PhysicsEngine::setGravity(const glm::vec3& newGravity) {
+    gravity = newGravity;
+    wakeAll();
+}
+
+void PhysicsEngine::setSolverIterations(int iterations) {
+    solver.setIterations(iterations);
+}
+
+void PhysicsEngine::setWarmStarting(bool enabled) {
+    solver.setWarmStarting(enabled);
+}
+
+void PhysicsEngine::setSleepEnabled(bool enabled) {
+    if (!enabled) {
+        wakeAll();
+    }
+    islands.setEnabled(enabled);
+}
+
+void PhysicsEngine::setSleepThreshold(float speed, uint32_t steps) {
+    islands.setThreshold(speed, steps);
+}
+
+uint32_t PhysicsEngine::getIslandCount() const {
+    return islands.getIslandCount();
+}
+
+size_t PhysicsEngine::getSleepingIslandCount() const {
+    return islands.getSleepingIslandCount();
+}
+
+void PhysicsEngine::wakeAll() {
+    if (islands.getSleepingIslandCount() > 0) {
+        islands.wakeAll(bodies);
+        broadphase->invalidate();
+    }
+}
+
+void PhysicsEngine::setContinuousCollision(bool enabled) {
+    continuousCollision = enabled;
+}
+
+void PhysicsEngine::setCcdThreshold(float fractionOfRadius) {
+    ccdThreshold = std::max(fractionOfRadius, 0.0f);
+}
+
+void PhysicsEngine::setDeterministic(bool enabled) {
+    deterministic = enabled;
+    integrator.setDeterministic(enabled);
+}
+
+void PhysicsEngine::setSimdLevel(SimdLevel level) {
+    integrator.setSimdLevel(level);
+}
+
+SimdLevel PhysicsEngine::getSimdLevel() const {
+    return integrator.getSimdLevel();
+}
+
+void PhysicsEngine::setWorldBounds(const AABB& bounds) {
+    worldBounds = bounds;
+    hasWorldBounds = true;
+    wakeAll();
+}
+
+void PhysicsEngine::setBroadphase(BroadphaseType type) {
+    broadphaseType = type;
+    switch (type) {
+    case BroadphaseType::SweepAndPrune:
+        broadphase = std::make_unique<SweepAndPrune>();
+        break;
+    case BroadphaseType::SpatialHash:
+    default:
+        broadphase = std::make_unique<SpatialHashBroadphase>(broadphaseCellSize);
+        break;
+    }
+    verletBroadphase = nullptr;
+    if (broadphaseSkin > 0.0f) {
+        auto verlet = std::make_unique<VerletBroadphase>(std::move(broadphase), broadphaseSkin);
+        verletBroadphase = verlet.get();
+        broadphase = std::move(verlet);
+    }
+    broadphase->setJobSystem(jobSystem);
+}
+
+Broadphase& PhysicsEngine::getBasicBroadphase() {
+    return verletBroadphase ? verletBroadphase->getInner() : *broadphase;
+}
+
+BroadphaseType PhysicsEngine::getBroadphaseType() const {
+    return broadphaseType;
+}
+
+void PhysicsEngine::setBroadphaseCellSize(float cellSize) {
+    broadphaseCellSize = cellSize;
+    if (broadphaseType == BroadphaseType::SpatialHash) {
+        static_cast<SpatialHashBroadphase&>(getBasicBroadphase()).setCellSize(cellSize);
+    }
+}
+
+void PhysicsEngine::setBroadphaseSkin(float skin) {
+    skin = std::max(skin, 0.0f);
+    if ((skin > 0.0f) != (broadphaseSkin > 0.0f)) {
+        broadphaseSkin = skin;
+        setBroadphase(broadphaseType);
+    } else if (verletBroadphase) {
+        broadphaseSkin = skin;
+        verletBroadphase->setSkin(skin);
+        verletBroadphase->invalidate();
+    }
+}
+
+float PhysicsEngine::getBroadphaseSkin() const {
+    return broadphaseSkin;
+}
+
+const std::vector<BroadphasePair>& PhysicsEngine::getCandidatePairs() const {
+    return candidatePairs;
+}
+
+size_t PhysicsEngine::getContactCount() const {
+    return contacts.size();
+}
+
+const std::vector<Contact>& PhysicsEngine::getContacts() const {
+    return contacts;
+}
+
+// Bump when the layout below changes; older snapshots are then refused.
+static const uint32_t snapshotMagic = 0x53485950; // "PYHS"
+static const uint32_t snapshotVersion = 3;
+
+void PhysicsEngine::saveSnapshot(std::vector<uint8_t>& snapshot) const {
+    snapshot.clear();
+    SnapshotWriter out(snapshot);
+    out.write(snapshotMagic);
+    out.write(snapshotVersion);
+    out.write(stepCount);
+    out.write(randomSeed);
+    out.write(gravity);
+    out.write(worldBounds);
+    out.write(hasWorldBounds);
+    out.write(continuousCollision);
+    out.write(ccdThreshold);
+    out.write(deterministic);
+    out.write(broadphaseType);
+    out.write(broadphaseCellSize);
+    out.write(reorderInterval);
+    out.write(mutualStrength);
+    out.write(mutualSoftening);
+    out.write(longRangeTree.getTheta());
+    bodies.save(out);
+    solver.save(out);
+    islands.save(out);
+    out.writeVector(planes);
+    out.writeVector(contacts);
+}
+
+bool PhysicsEngine::loadSnapshot(const std::vector<uint8_t>& snapshot) {
+    SnapshotReader in(snapshot);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    in.read(magic);
+    in.read(version);
+    if (magic != snapshotMagic || version != snapshotVersion) {
+        return false;
+    }
+
+    // Read into temporaries so a damaged snapshot can't leave us half loaded.
+    uint64_t loadedStep, loadedSeed;
+    glm::vec3 loadedGravity;
+    AABB loadedWorldBounds;
+    bool loadedHasWorldBounds, loadedContinuous, loadedDeterministic;
+    float loadedCcdThreshold, loadedCellSize;
+    uint32_t loadedReorderInterval;
+    float loadedMutualStrength, loadedMutualSoftening, loadedTheta;
+    BroadphaseType loadedBroadphase;
+    BodyStorage loadedBodies;
+    ContactSolver loadedSolver;
+    IslandManager loadedIslands;
+    std::vector<BodyHandle> loadedPlanes;
+    std::vector<Contact> loadedContacts;
+    in.read(loadedStep);
+    in.read(loadedSeed);
+    in.read(loadedGravity);
+    in.read(loadedWorldBounds);
+    in.read(loadedHasWorldBounds);
+    in.read(loadedContinuous);
+    in.read(loadedCcdThreshold);
+    in.read(loadedDeterministic);
+    in.read(loadedBroadphase);
+    in.read(loadedCellSize);
+    in.read(loadedReorderInterval);
+    in.read(loadedMutualStrength);
+    in.read(loadedMutualSoftening);
+    in.read(loadedTheta);
+    bool ok = loadedBodies.load(in) && loadedSolver.load(in) && loadedIslands.load(in);
+    in.readVector(loadedPlanes);
+    in.readVector(loadedContacts);
+    if (!ok || !in.ok() || !in.atEnd()) {
+        return false;
+    }
+    // Each part checked itself; they also have to agree on the bodies.
+    if (!loadedIslands.isConsistentWith(loadedBodies)) {
+        return false;
+    }
+    for (BodyHandle handle : loadedPlanes) {
+        if (!loadedBodies.isValid(handle) ||
+            loadedBodies.collider[loadedBodies.denseIndex(handle)].getType() != ColliderType::Plane) {
+            return false;
+        }
+    }
+    uint32_t loadedCount = loadedBodies.size();
+    for (const Contact& contact : loadedContacts) {
+        if (contact.a >= loadedCount || (contact.b != Contact::world && contact.b >= loadedCount)) {
+            return false;
+        }
+    }
+
+    stepCount = loadedStep;
+    randomSeed = loadedSeed;
+    gravity = loadedGravity;
+    worldBounds = loadedWorldBounds;
+    hasWorldBounds = loadedHasWorldBounds;
+    continuousCollision = loadedContinuous;
+    ccdThreshold = loadedCcdThreshold;
+    broadphaseCellSize = loadedCellSize;
+    reorderInterval = loadedReorderInterval;
+    mutualStrength = loadedMutualStrength;
+    mutualSoftening = loadedMutualSoftening;
+    longRangeTree.setTheta(loadedTheta);
+    bodies = std::move(loadedBodies);
+    solver = std::move(loadedSolver);
+    islands = std::move(loadedIslands);
+    planes = std::move(loadedPlanes);
+    contacts = std::move(loadedContacts);
+    candidatePairs.clear();
+    setDeterministic(loadedDeterministic);
+    // A fresh broadphase: sweep and prune must not carry pairs over from
+    // the state we just replaced.
+    setBroadphase(loadedBroadphase);
+    rebuildQueryTree();
+    return true;
+}
+
+void PhysicsEngine::rebuildQueryTree() {
+    queryTree = DynamicAABBTree();
+    slotProxies.clear();
+    uint32_t count = bodies.size();
+    for (uint32_t i = 0; i < count; ++i) {
+        BodyHandle handle = bodies.handleAt(i);
+        if (slotProxies.size() <= handle.index) {
+            slotProxies.resize(handle.index + 1, DynamicAABBTree::nullNode);
+        }
+        if (!isPlane(bodies, i)) {
+            void* userData = reinterpret_cast<void*>(static_cast<uintptr_t>(handle.index));
+            slotProxies[handle.index] = queryTree.createProxy(colliderBounds(bodies, i, bodies.position(i), 0.0f), userData);
+        }
+    }
+}
+
+PhysicsProfiler& PhysicsEngine::getProfiler() {
+    return profiler;
+}
+
+const PhysicsProfiler& PhysicsEngine::getProfiler() const {
+    return profiler;
+}
+
+uint64_t PhysicsEngine::getStepCount() const {
+    return stepCount;
+}
+
+void PhysicsEngine::setRandomSeed(uint64_t seed) {
+    randomSeed = seed;
+}
+
+uint64_t PhysicsEngine::getRandomSeed() const {
+    return randomSeed;
+}
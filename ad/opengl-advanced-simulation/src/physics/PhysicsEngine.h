@@ -1,20 +1,220 @@
 #ifndef PHYSICS_ENGINE_H
 #define PHYSICS_ENGINE_H
 
+#include <memory>
 #include <vector>
+#include "AABB.h"
+#include "BarnesHutTree.h"
+#include "BodyStorage.h"
+#include "Broadphase.h"
+#include "Contact.h"
+#include "ContactSolver.h"
+#include "DynamicAABBTree.h"
+#include "Integrator.h"
+#include "IslandManager.h"
+#include "PhysicsProfiler.h"
 #include "RigidBody.h"
+#include "Snapshot.h"
+#include "VerletBroadphase.h"
+
+class JobSystem;
+
+struct RaycastHit {
+    BodyHandle body;
+    float distance;
+    glm::vec3 point;
+    glm::vec3 normal;
+};
 
 class PhysicsEngine {
 public:
     PhysicsEngine();
     ~PhysicsEngine();
 
-    void addRigidBody(RigidBody* body);
-    void removeRigidBody(RigidBody* body);
+    // The engine copies the body into its own storage; keep the handle to
+    // refer to it afterwards.
+    BodyHandle addRigidBody(const RigidBody& body);
+    void removeRigidBody(BodyHandle handle);
+    bool isValid(BodyHandle handle) const;
     void update(float deltaTime);
 
+    void applyForce(BodyHandle handle, const glm::vec3& force);
+    void setPosition(BodyHandle handle, const glm::vec3& position);
+    void setVelocity(BodyHandle handle, const glm::vec3& velocity);
+    glm::vec3 getPosition(BodyHandle handle) const;
+    // Blend of the positions before and after the last update; alpha comes
+    // from FixedTimestep::getAlpha.
+    glm::vec3 getInterpolatedPosition(BodyHandle handle, float alpha) const;
+    void getInterpolatedPositions(float alpha, std::vector<glm::vec3>& positions) const;
+    glm::vec3 getVelocity(BodyHandle handle) const;
+    const Collider& getCollider(BodyHandle handle) const;
+    bool isAwake(BodyHandle handle) const;
+    void wakeBody(BodyHandle handle);
+    // Bounding radius for colliders other than spheres.
+    float getRadius(BodyHandle handle) const;
+    uint32_t getBodyCount() const;
+    uint32_t getAwakeBodyCount() const;
+    // Packed per-body columns, handy for streaming into instance buffers.
+    const BodyStorage& getBodies() const;
+
+    // Spreads integration, pair finding and narrowphase over the pool. Contacts
+    // are still resolved on the calling thread in a fixed order, so results
+    // don't depend on the thread count. Null runs everything inline.
+    void setJobSystem(JobSystem* jobs);
+
+    void setGravity(const glm::vec3& gravity);
+    // Contact solver passes per step; warm starting lets this stay low.
+    void setSolverIterations(int iterations);
+    void setWarmStarting(bool enabled);
+    // Islands whose bodies all stay below speed for steps consecutive updates
+    // fall asleep and are skipped until touched, pushed or moved.
+    void setSleepEnabled(bool enabled);
+    void setSleepThreshold(float speed, uint32_t steps);
+    uint32_t getIslandCount() const;
+    size_t getSleepingIslandCount() const;
+    // Bodies moving further than this fraction of their radius in one step
+    // are swept against everything they pass, so they can't tunnel.
+    void setContinuousCollision(bool enabled);
+    void setCcdThreshold(float fractionOfRadius);
+    // Deterministic mode keeps results bit-identical whatever SIMD level the
+    // integrator runs at, and puts candidate pairs in a canonical order so the
+    // broadphase's history can't change the solve order.
+    void setDeterministic(bool deterministic);
+    void setSimdLevel(SimdLevel level);
+    SimdLevel getSimdLevel() const;
+    // Bodies collide with the inside of this box; disabled until set.
+    void setWorldBounds(const AABB& bounds);
+    // The spatial hash is the default; sweep and prune copes better with
+    // bodies of very different sizes.
+    void setBroadphase(BroadphaseType type);
+    BroadphaseType getBroadphaseType() const;
+    // Only used by the spatial hash; <= 0 sizes the cells automatically.
+    void setBroadphaseCellSize(float cellSize);
+    // A skin > 0 caches the pairs of boxes grown by half the skin and only
+    // runs the broadphase again once some body has moved further than that,
+    // so calm scenes skip it on most steps. The pairs found are the same
+    // either way. Larger skins rebuild less often but filter more pairs; a
+    // few times the distance a typical body moves per step works well. Off
+    // by default, and a machine setting like the job system: not saved in
+    // snapshots.
+    void setBroadphaseSkin(float skin);
+    float getBroadphaseSkin() const;
+
+    // Inverse-square force between every two dynamic bodies,
+    //   strength * m1 * m2 / (r^2 + softening^2),
+    // which pulls them together for a positive strength (gravity) and pushes
+    // them apart for a negative one. It is summed with a Barnes-Hut octree
+    // rebuilt every step, so it costs O(n log n) rather than O(n^2). Cells
+    // smaller than theta times their distance count as a single mass: lower
+    // theta is more accurate, higher is faster. Strength 0, the default, is
+    // off.
+    void setMutualForce(float strength, float softening = 0.1f);
+    float getMutualForceStrength() const;
+    float getMutualForceSoftening() const;
+    void setBarnesHutTheta(float theta);
+    float getBarnesHutTheta() const;
+
+    // Every interval steps (0, the default, is never) bodies are re-sorted
+    // along a Z-order (Morton) curve, awake and sleeping ones separately, so
+    // bodies close in space are close in memory as well and the broadphase,
+    // narrowphase and solver jump around less. Packed indices change, handles
+    // don't. Changes the solve order, so it is saved in snapshots.
+    void setReorderInterval(uint32_t steps);
+    uint32_t getReorderInterval() const;
+    void reorderBodies();
+    // For renderers that keep per-body data such as instance colors in packed
+    // order: when the count changes, the entry at packed index i before the
+    // reorder belongs at getReorderRemap()[i].
+    uint64_t getReorderCount() const;
+    const std::vector<uint32_t>& getReorderRemap() const;
+
+    // Spatial queries, answered from a bounding volume tree that follows
+    // every body, plus a direct test against each plane. direction must be
+    // normalized.
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+    void overlapSphere(const glm::vec3& center, float radius, std::vector<BodyHandle>& results) const;
+    void overlapBox(const AABB& box, std::vector<BodyHandle>& results) const;
+
+    // Pairs and contacts use packed body indices from the last solve. Bodies
+    // falling asleep or waking at the end of that update reorder the packing,
+    // so prefer handles for anything kept around.
+    const std::vector<BroadphasePair>& getCandidatePairs() const;
+    size_t getContactCount() const;
+    const std::vector<Contact>& getContacts() const;
+
+    // Phase timings and counters for the most recent steps, on by default.
+    PhysicsProfiler& getProfiler();
+    const PhysicsProfiler& getProfiler() const;
+
+    // Full simulation state: bodies with their handle slots, cached contact
+    // impulses, sleeping islands, settings, the last step's contacts, the
+    // step counter and the random seed. With deterministic mode on, loading a
+    // snapshot and repeating the same calls replays the run bit for bit, so
+    // keeping a few recent snapshots is enough to roll back and resimulate.
+    // The job system and SIMD level belong to the machine and aren't saved.
+    void saveSnapshot(std::vector<uint8_t>& snapshot) const;
+    // Leaves the engine untouched and returns false if the data is damaged
+    // or from another snapshot version.
+    bool loadSnapshot(const std::vector<uint8_t>& snapshot);
+    uint64_t getStepCount() const;
+    // Not used by the engine itself; stored so gameplay code can key its own
+    // random streams on (seed, step) and have them roll back with physics.
+    void setRandomSeed(uint64_t seed);
+    uint64_t getRandomSeed() const;
+
 private:
-    std::vector<RigidBody*> rigidBodies;
+    void sweepFastBodies();
+    void findBoundsContacts();
+    // Both return the number of narrowphase tests they ran.
+    uint32_t findPlaneContacts();
+    uint32_t findContacts();
+    void updateQueryTree(float deltaTime);
+    void applyMutualForces();
+    void recordProfile(uint32_t pairsTested, bool broadphaseRan);
+    void wakeAll();
+    void rebuildQueryTree();
+    Broadphase& getBasicBroadphase();
+
+    BodyStorage bodies;
+    std::vector<int> slotProxies; // query tree proxy per handle slot
+    std::vector<BodyHandle> planes;
+    DynamicAABBTree queryTree;
+    Integrator integrator;
+    ContactSolver solver;
+    IslandManager islands;
+    PhysicsProfiler profiler;
+    BarnesHutTree longRangeTree;
+    std::vector<float> bodyMass;
+    std::vector<glm::vec3> longRangeFields;
+    std::unique_ptr<Broadphase> broadphase;
+    VerletBroadphase* verletBroadphase; // broadphase itself when the skin is on
+    BroadphaseType broadphaseType;
+    float broadphaseCellSize;
+    float broadphaseSkin;
+    std::vector<AABB> bodyBounds;
+    std::vector<AABB> broadphaseBounds; // bodyBounds without the planes
+    std::vector<uint32_t> broadphaseBodies; // dense index of each of those
+    std::vector<uint8_t> fastBodies;
+    std::vector<float> impactTimes;
+    std::vector<BroadphasePair> candidatePairs;
+    std::vector<Contact> pairContacts;
+    std::vector<uint8_t> pairResults;
+    std::vector<Contact> contacts;
+    std::vector<uint64_t> mortonKeys;
+    std::vector<uint32_t> reorderRemap;
+    JobSystem* jobSystem;
+    glm::vec3 gravity;
+    AABB worldBounds;
+    bool hasWorldBounds;
+    bool continuousCollision;
+    float ccdThreshold;
+    bool deterministic;
+    uint64_t stepCount;
+    uint64_t randomSeed;
+    uint32_t reorderInterval;
+    uint64_t reorderCount;
+    float mutualStrength;
+    float mutualSoftening;
 };
 
-#endif // PHYSICS_ENGINE_H
\ No newline at end of file
+#endif // PHYSICS_ENGINE_H
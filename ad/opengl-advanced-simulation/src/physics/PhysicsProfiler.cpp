@@ -0,0 +1,151 @@
+#include "PhysicsProfiler.h"
+#include <algorithm>
+
+static const char* const phaseNames[] = {
+    "integrate", "broadphase", "continuousCollision", "narrowphase", "solver", "queryTree", "islands", "reorder", "longRangeForces"
+};
+
+const char* getPhysicsPhaseName(PhysicsPhase phase) {
+    size_t index = static_cast<size_t>(phase);
+    return index < sizeof(phaseNames) / sizeof(phaseNames[0]) ? phaseNames[index] : "unknown";
+}
+
+static const size_t phaseCount = static_cast<size_t>(PhysicsPhase::Count);
+static const size_t counterCount = 12;
+
+static void addCounters(const StepProfile& profile, double sums[counterCount]) {
+    const uint32_t counters[counterCount] = {
+        profile.bodies, profile.awakeBodies, profile.sleepingBodies, profile.fastBodies,
+        profile.candidatePairs, profile.broadphaseRebuilds, profile.pairsTested, profile.contacts, profile.manifolds,
+        profile.solverIterations, profile.islands, profile.sleepingIslands
+    };
+    for (size_t c = 0; c < counterCount; ++c) {
+        sums[c] += counters[c];
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+PhysicsProfiler::Scope::Scope(PhysicsProfiler& profiler, PhysicsPhase phase)
+    : profiler(profiler.enabled ? &profiler : nullptr), phase(phase) {
+    if (this->profiler) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+PhysicsProfiler::Scope::~Scope() {
+    if (profiler) {
+        profiler->active.phaseMs[static_cast<size_t>(phase)] += millisecondsSince(start);
+    }
+}
+
+PhysicsProfiler::PhysicsProfiler(size_t historySize)
+    : enabled(true), active(), capacity(std::max<size_t>(historySize, 1)), next(0) {
+    frames.reserve(capacity);
+}
+
+void PhysicsProfiler::setEnabled(bool newEnabled) {
+    enabled = newEnabled;
+}
+
+bool PhysicsProfiler::isEnabled() const {
+    return enabled;
+}
+
+void PhysicsProfiler::setHistorySize(size_t newFrames) {
+    capacity = std::max<size_t>(newFrames, 1);
+    clear();
+    frames.reserve(capacity);
+}
+
+size_t PhysicsProfiler::getHistorySize() const {
+    return capacity;
+}
+
+void PhysicsProfiler::clear() {
+    frames.clear();
+    next = 0;
+}
+
+void PhysicsProfiler::beginStep(uint64_t step) {
+    if (!enabled) {
+        return;
+    }
+    active = StepProfile();
+    active.step = step;
+    stepStart = std::chrono::steady_clock::now();
+}
+
+StepProfile& PhysicsProfiler::current() {
+    return active;
+}
+
+void PhysicsProfiler::endStep() {
+    if (!enabled) {
+        return;
+    }
+    active.totalMs = millisecondsSince(stepStart);
+    if (frames.size() < capacity) {
+        frames.push_back(active);
+    } else {
+        frames[next] = active;
+    }
+    next = (next + 1) % capacity;
+}
+
+const StepProfile& PhysicsProfiler::getLastStep() const {
+    static const StepProfile empty = StepProfile();
+    if (frames.empty()) {
+        return empty;
+    }
+    return frames[(next + capacity - 1) % capacity];
+}
+
+size_t PhysicsProfiler::getFrameCount() const {
+    return frames.size();
+}
+
+const StepProfile& PhysicsProfiler::getFrame(size_t index) const {
+    // Until the buffer wraps the oldest frame sits at 0, afterwards at next.
+    size_t oldest = frames.size() < capacity ? 0 : next;
+    return frames[(oldest + index) % frames.size()];
+}
+
+void PhysicsProfiler::getHistory(std::vector<StepProfile>& history) const {
+    history.clear();
+    for (size_t i = 0; i < frames.size(); ++i) {
+        history.push_back(getFrame(i));
+    }
+}
+
+StepProfile PhysicsProfiler::getAverage() const {
+    StepProfile average = StepProfile();
+    if (frames.empty()) {
+        return average;
+    }
+    double sums[counterCount] = {};
+    for (const StepProfile& frame : frames) {
+        average.totalMs += frame.totalMs;
+        for (size_t p = 0; p < phaseCount; ++p) {
+            average.phaseMs[p] += frame.phaseMs[p];
+        }
+        addCounters(frame, sums);
+    }
+    double n = static_cast<double>(frames.size());
+    average.totalMs /= n;
+    for (size_t p = 0; p < phaseCount; ++p) {
+        average.phaseMs[p] /= n;
+    }
+    uint32_t* counters[counterCount] = {
+        &average.bodies, &average.awakeBodies, &average.sleepingBodies, &average.fastBodies,
+        &average.candidatePairs, &average.broadphaseRebuilds, &average.pairsTested, &average.contacts, &average.manifolds,
+        &average.solverIterations, &average.islands, &average.sleepingIslands
+    };
+    for (size_t c = 0; c < counterCount; ++c) {
+        *counters[c] = static_cast<uint32_t>(sums[c] / n + 0.5);
+    }
+    average.step = getLastStep().step;
+    return average;
+}
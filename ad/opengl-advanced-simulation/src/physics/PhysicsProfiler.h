@@ -0,0 +1,100 @@
+#ifndef PHYSICS_PROFILER_H
+#define PHYSICS_PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class PhysicsPhase {
+    Integrate,
+    Broadphase,
+    ContinuousCollision,
+    Narrowphase,
+    Solver,
+    QueryTree,
+    Islands,
+    Reorder,
+    LongRangeForces,
+    Count
+};
+
+const char* getPhysicsPhaseName(PhysicsPhase phase);
+
+// Timings and counters for one PhysicsEngine::update.
+struct StepProfile {
+    uint64_t step;
+    double totalMs;
+    double phaseMs[static_cast<size_t>(PhysicsPhase::Count)];
+    uint32_t bodies;
+    uint32_t awakeBodies;
+    uint32_t sleepingBodies;
+    uint32_t fastBodies;         // swept by continuous collision
+    uint32_t candidatePairs;     // from the broadphase
+    uint32_t broadphaseRebuilds; // 0 when a cached pair list was reused
+    uint32_t pairsTested;        // pairs and plane tests that ran a narrowphase
+    uint32_t contacts;
+    uint32_t manifolds;
+    uint32_t solverIterations;
+    uint32_t islands;
+    uint32_t sleepingIslands;
+
+    double getPhaseMs(PhysicsPhase phase) const {
+        return phaseMs[static_cast<size_t>(phase)];
+    }
+};
+
+// Collects a StepProfile per physics step and keeps the last few in a ring
+// buffer, for overlays and benchmarks. Timing costs a clock read per phase,
+// and nothing at all while disabled.
+class PhysicsProfiler {
+public:
+    // Times the enclosing block and adds it to the phase.
+    class Scope {
+    public:
+        Scope(PhysicsProfiler& profiler, PhysicsPhase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        PhysicsProfiler* profiler;
+        PhysicsPhase phase;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    explicit PhysicsProfiler(size_t historySize = 240);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    // Clears the history.
+    void setHistorySize(size_t frames);
+    size_t getHistorySize() const;
+    void clear();
+
+    // Used by the engine around each step; counters are filled in through
+    // current() in between.
+    void beginStep(uint64_t step);
+    StepProfile& current();
+    void endStep();
+
+    // Most recent finished step, zeroed before the first one.
+    const StepProfile& getLastStep() const;
+    size_t getFrameCount() const;
+    // 0 is the oldest frame still kept.
+    const StepProfile& getFrame(size_t index) const;
+    void getHistory(std::vector<StepProfile>& frames) const;
+    // Mean of every kept frame; step is that of the newest.
+    StepProfile getAverage() const;
+
+private:
+    bool enabled;
+    StepProfile active;
+    std::chrono::steady_clock::time_point stepStart;
+    std::vector<StepProfile> frames;
+    size_t capacity;
+    size_t next;
+};
+
+#endif // PHYSICS_PROFILER_H
@@ -1,7 +1,8 @@
 #include "RigidBody.h"
 
-RigidBody::RigidBody(float mass, const glm::vec3& position)
-    : mass(mass), position(position), velocity(0.0f), force(0.0f) {}
+RigidBody::RigidBody(float mass, const glm::vec3& position, float radius)
+    : mass(mass), radius(radius), restitution(0.8f), friction(0.3f), position(position), velocity(0.0f), force(0.0f),
+      collider(Collider::sphere(radius)) {}
 
 void RigidBody::applyForce(const glm::vec3& force) {
     this->force += force;
@@ -16,6 +17,31 @@ void RigidBody::update(float deltaTime) {
     }
 }
 
+void RigidBody::setMass(float mass) {
+    this->mass = mass;
+}
+
+void RigidBody::setPosition(const glm::vec3& position) {
+    this->position = position;
+}
+
+void RigidBody::setVelocity(const glm::vec3& velocity) {
+    this->velocity = velocity;
+}
+
+void RigidBody::setRestitution(float restitution) {
+    this->restitution = restitution;
+}
+
+void RigidBody::setFriction(float friction) {
+    this->friction = friction;
+}
+
+void RigidBody::setCollider(const Collider& collider) {
+    this->collider = collider;
+    radius = collider.getBoundingRadius();
+}
+
 glm::vec3 RigidBody::getPosition() const {
     return position;
 }
@@ -26,4 +52,20 @@ glm::vec3 RigidBody::getVelocity() const {
 
 float RigidBody::getMass() const {
     return mass;
-}
\ No newline at end of file
+}
+
+float RigidBody::getRadius() const {
+    return radius;
+}
+
+float RigidBody::getRestitution() const {
+    return restitution;
+}
+
+float RigidBody::getFriction() const {
+    return friction;
+}
+
+const Collider& RigidBody::getCollider() const {
+    return collider;
+}
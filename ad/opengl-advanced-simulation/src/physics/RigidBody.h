@@ -1,21 +1,38 @@
 #ifndef RIGIDBODY_H
 #define RIGIDBODY_H
 
+#include <glm/glm.hpp>
+#include "Collider.h"
+
 class RigidBody {
 public:
-    RigidBody(float mass);
+    RigidBody(float mass, const glm::vec3& position, float radius = 0.5f);
     void applyForce(const glm::vec3& force);
     void update(float deltaTime);
     void setMass(float mass);
+    void setPosition(const glm::vec3& position);
+    void setVelocity(const glm::vec3& velocity);
+    void setRestitution(float restitution);
+    void setFriction(float friction);
+    // Replaces the default sphere; the radius becomes the bounding radius.
+    void setCollider(const Collider& collider);
     float getMass() const;
+    float getRadius() const;
+    float getRestitution() const;
+    float getFriction() const;
+    const Collider& getCollider() const;
     glm::vec3 getPosition() const;
     glm::vec3 getVelocity() const;
 
 private:
     float mass;
+    float radius;
+    float restitution;
+    float friction;
     glm::vec3 position;
     glm::vec3 velocity;
-    glm::vec3 acceleration;
+    glm::vec3 force;
+    Collider collider;
 };
 
-#endif // RIGIDBODY_H
\ No newline at end of file
+#endif // RIGIDBODY_H
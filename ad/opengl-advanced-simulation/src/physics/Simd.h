@@ -0,0 +1,25 @@
+#ifndef PHYSICS_SIMD_H
+#define PHYSICS_SIMD_H
+
+// Per-function x86 target attributes, so SSE and AVX2 kernels can live in one
+// binary built for the baseline CPU and be picked at runtime with
+// Integrator::detectSimdLevel.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHYSICS_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PHYSICS_TARGET_AVX2
+#define PHYSICS_TARGET_AVX2_FMA
+#define PHYSICS_TARGET_SSE2
+#else
+// The exact kernels are compiled without FMA enabled so the compiler can't
+// contract their multiplies and adds behind our back.
+#define PHYSICS_TARGET_AVX2 __attribute__((target("avx2")))
+#define PHYSICS_TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+#define PHYSICS_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+#endif // PHYSICS_SIMD_H
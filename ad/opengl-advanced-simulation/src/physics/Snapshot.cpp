@@ -0,0 +1,21 @@
+#include "Snapshot.h"
+#include <fstream>
+#include <iterator>
+
+bool writeSnapshotFile(const std::string& path, const std::vector<uint8_t>& snapshot) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(snapshot.data()), static_cast<std::streamsize>(snapshot.size()));
+    return file.good();
+}
+
+bool readSnapshotFile(const std::string& path, std::vector<uint8_t>& snapshot) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    snapshot.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
@@ -0,0 +1,84 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Raw binary stream for physics snapshots. Values are copied byte for byte,
+// so a snapshot is only meant to be restored by the same build on the same
+// kind of machine, which is all bit-exact replay needs anyway.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::vector<uint8_t>& buffer) : buffer(buffer) {}
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be plain data");
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void writeVector(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be plain data");
+        write(static_cast<uint64_t>(values.size()));
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values.data());
+        buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+private:
+    std::vector<uint8_t>& buffer;
+};
+
+// Reads what SnapshotWriter wrote. Running past the end, or a size that
+// can't fit in what's left, marks the reader failed; later reads then return
+// zeroes, so callers can check ok() once at the end.
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const std::vector<uint8_t>& buffer) : buffer(buffer), offset(0), failed(false) {}
+
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be plain data");
+        if (failed || buffer.size() - offset < sizeof(T)) {
+            failed = true;
+            std::memset(static_cast<void*>(&value), 0, sizeof(T));
+            return;
+        }
+        std::memcpy(static_cast<void*>(&value), buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+    }
+
+    template <typename T>
+    void readVector(std::vector<T>& values) {
+        uint64_t count = 0;
+        read(count);
+        if (failed || count > (buffer.size() - offset) / sizeof(T)) {
+            failed = true;
+            values.clear();
+            return;
+        }
+        values.resize(static_cast<size_t>(count));
+        if (values.empty()) {
+            return;
+        }
+        std::memcpy(static_cast<void*>(values.data()), buffer.data() + offset, values.size() * sizeof(T));
+        offset += values.size() * sizeof(T);
+    }
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return offset == buffer.size(); }
+
+private:
+    const std::vector<uint8_t>& buffer;
+    size_t offset;
+    bool failed;
+};
+
+bool writeSnapshotFile(const std::string& path, const std::vector<uint8_t>& snapshot);
+bool readSnapshotFile(const std::string& path, std::vector<uint8_t>& snapshot);
+
+#endif // SNAPSHOT_H
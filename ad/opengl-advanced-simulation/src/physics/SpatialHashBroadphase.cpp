@@ -0,0 +1,144 @@
+#include "SpatialHashBroadphase.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+// Buckets scanned per job; fixed so the pair order never depends on the
+// number of threads.
+static const uint32_t bucketsPerChunk = 4096;
+
+SpatialHashBroadphase::SpatialHashBroadphase(float cellSize)
+    : cellSize(cellSize), activeCellSize(1.0f), tableMask(0) {}
+
+void SpatialHashBroadphase::setCellSize(float newCellSize) {
+    cellSize = newCellSize;
+}
+
+float SpatialHashBroadphase::getCellSize() const {
+    return activeCellSize;
+}
+
+float SpatialHashBroadphase::chooseCellSize(const std::vector<AABB>& bounds) const {
+    if (bounds.empty()) {
+        return 1.0f;
+    }
+
+    // Twice the average size keeps typical bodies inside 2x2x2 cells while a
+    // few large ones only cost extra cell entries instead of a huge grid.
+    double total = 0.0;
+    for (const AABB& box : bounds) {
+        glm::vec3 size = box.extents();
+        total += std::max(size.x, std::max(size.y, size.z));
+    }
+    float average = static_cast<float>(total / bounds.size());
+    return average > 0.0f ? 2.0f * average : 1.0f;
+}
+
+uint32_t SpatialHashBroadphase::hashCell(int x, int y, int z) const {
+    uint32_t h = static_cast<uint32_t>(x) * 73856093u ^
+                 static_cast<uint32_t>(y) * 19349663u ^
+                 static_cast<uint32_t>(z) * 83492791u;
+    return h & tableMask;
+}
+
+int SpatialHashBroadphase::cellCoord(float value) const {
+    return static_cast<int>(std::floor(value / activeCellSize));
+}
+
+void SpatialHashBroadphase::findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) {
+    pairs.clear();
+    entries.clear();
+    activeCellSize = cellSize > 0.0f ? cellSize : chooseCellSize(bounds);
+
+    for (uint32_t i = 0; i < bounds.size(); ++i) {
+        const AABB& box = bounds[i];
+        int x0 = cellCoord(box.min.x), x1 = cellCoord(box.max.x);
+        int y0 = cellCoord(box.min.y), y1 = cellCoord(box.max.y);
+        int z0 = cellCoord(box.min.z), z1 = cellCoord(box.max.z);
+        for (int x = x0; x <= x1; ++x) {
+            for (int y = y0; y <= y1; ++y) {
+                for (int z = z0; z <= z1; ++z) {
+                    entries.push_back({ x, y, z, i });
+                }
+            }
+        }
+    }
+
+    if (entries.size() < 2) {
+        return;
+    }
+
+    uint32_t tableSize = 1;
+    while (tableSize < entries.size() * 2) {
+        tableSize <<= 1;
+    }
+    tableMask = tableSize - 1;
+
+    // Counting sort of the entries by bucket: one pass to count, a prefix sum
+    // and one pass to scatter, so building the table stays linear.
+    cellStart.assign(tableSize + 1, 0);
+    for (const CellEntry& entry : entries) {
+        ++cellStart[hashCell(entry.x, entry.y, entry.z) + 1];
+    }
+    for (uint32_t i = 0; i < tableSize; ++i) {
+        cellStart[i + 1] += cellStart[i];
+    }
+    sortedEntries.resize(entries.size());
+    cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+    for (const CellEntry& entry : entries) {
+        sortedEntries[cellCursor[hashCell(entry.x, entry.y, entry.z)]++] = entry;
+    }
+
+    // Buckets are independent, so chunks of them are scanned in parallel into
+    // their own lists and appended in chunk order.
+    uint32_t chunks = JobSystem::chunkCount(tableSize, bucketsPerChunk);
+    chunkPairs.resize(chunks);
+    parallelFor(jobSystem, chunks, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; ++chunk) {
+            uint32_t firstBucket = chunk * bucketsPerChunk;
+            uint32_t lastBucket = std::min(firstBucket + bucketsPerChunk, tableSize);
+            scanBuckets(bounds, firstBucket, lastBucket, chunkPairs[chunk]);
+        }
+    });
+
+    for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+        pairs.insert(pairs.end(), chunkPairs[chunk].begin(), chunkPairs[chunk].end());
+    }
+}
+
+void SpatialHashBroadphase::scanBuckets(const std::vector<AABB>& bounds, uint32_t firstBucket, uint32_t lastBucket,
+                                        std::vector<BroadphasePair>& pairs) const {
+    pairs.clear();
+    for (uint32_t bucket = firstBucket; bucket < lastBucket; ++bucket) {
+        uint32_t begin = cellStart[bucket];
+        uint32_t end = cellStart[bucket + 1];
+        for (uint32_t i = begin; i + 1 < end; ++i) {
+            const CellEntry& first = sortedEntries[i];
+            const AABB& boxA = bounds[first.body];
+            for (uint32_t j = i + 1; j < end; ++j) {
+                const CellEntry& second = sortedEntries[j];
+                // Different cells can share a bucket after hashing.
+                if (first.x != second.x || first.y != second.y || first.z != second.z) {
+                    continue;
+                }
+                const AABB& boxB = bounds[second.body];
+                if (!boxA.overlaps(boxB)) {
+                    continue;
+                }
+
+                // A pair that spans several shared cells is only reported by
+                // the cell holding the min corner of the overlap region.
+                glm::vec3 overlapMin = glm::max(boxA.min, boxB.min);
+                if (cellCoord(overlapMin.x) != first.x ||
+                    cellCoord(overlapMin.y) != first.y ||
+                    cellCoord(overlapMin.z) != first.z) {
+                    continue;
+                }
+
+                uint32_t a = std::min(first.body, second.body);
+                uint32_t b = std::max(first.body, second.body);
+                pairs.push_back({ a, b });
+            }
+        }
+    }
+}
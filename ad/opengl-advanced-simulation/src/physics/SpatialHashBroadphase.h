@@ -0,0 +1,43 @@
+#ifndef SPATIAL_HASH_BROADPHASE_H
+#define SPATIAL_HASH_BROADPHASE_H
+
+#include <cstdint>
+#include <vector>
+#include "Broadphase.h"
+
+// Uniform grid broadphase backed by a hash table. Every body is inserted into
+// the cells its bounds touch and pairs are only tested inside a cell, so the
+// cost grows with the number of bodies instead of the number of pairs.
+class SpatialHashBroadphase : public Broadphase {
+public:
+    explicit SpatialHashBroadphase(float cellSize = 0.0f);
+
+    // A cell size <= 0 picks one from the average body size on every call.
+    void setCellSize(float cellSize);
+    float getCellSize() const;
+
+    void findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) override;
+
+private:
+    struct CellEntry {
+        int x, y, z;
+        uint32_t body;
+    };
+
+    float chooseCellSize(const std::vector<AABB>& bounds) const;
+    void scanBuckets(const std::vector<AABB>& bounds, uint32_t firstBucket, uint32_t lastBucket,
+                     std::vector<BroadphasePair>& pairs) const;
+    uint32_t hashCell(int x, int y, int z) const;
+    int cellCoord(float value) const;
+
+    float cellSize;
+    float activeCellSize;
+    uint32_t tableMask;
+    std::vector<CellEntry> entries;
+    std::vector<CellEntry> sortedEntries;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellCursor;
+    std::vector<std::vector<BroadphasePair>> chunkPairs;
+};
+
+#endif // SPATIAL_HASH_BROADPHASE_H
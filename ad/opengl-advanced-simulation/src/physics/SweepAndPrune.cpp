@@ -0,0 +1,124 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+SweepAndPrune::SweepAndPrune() : bodyCount(0), needsRebuild(true) {}
+
+void SweepAndPrune::invalidate() {
+    needsRebuild = true;
+}
+
+bool SweepAndPrune::less(const Endpoint& a, const Endpoint& b) {
+    // On equal values a min endpoint sorts first, so touching boxes overlap
+    // just like they do for AABB::overlaps.
+    if (a.value != b.value) {
+        return a.value < b.value;
+    }
+    return !a.isMax() && b.isMax();
+}
+
+uint64_t SweepAndPrune::pairKey(uint32_t a, uint32_t b) {
+    if (a > b) {
+        std::swap(a, b);
+    }
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+void SweepAndPrune::addPair(uint32_t a, uint32_t b) {
+    uint64_t key = pairKey(a, b);
+    if (pairIndex.count(key)) {
+        return;
+    }
+    pairIndex[key] = static_cast<uint32_t>(activePairs.size());
+    activePairs.push_back({ std::min(a, b), std::max(a, b) });
+}
+
+void SweepAndPrune::removePair(uint32_t a, uint32_t b) {
+    auto it = pairIndex.find(pairKey(a, b));
+    if (it == pairIndex.end()) {
+        return;
+    }
+
+    // Swap-remove from the dense pair array and patch the moved entry.
+    uint32_t index = it->second;
+    pairIndex.erase(it);
+    const BroadphasePair& last = activePairs.back();
+    if (index + 1 != activePairs.size()) {
+        activePairs[index] = last;
+        pairIndex[pairKey(last.a, last.b)] = index;
+    }
+    activePairs.pop_back();
+}
+
+void SweepAndPrune::rebuild(const std::vector<AABB>& bounds) {
+    bodyCount = bounds.size();
+    activePairs.clear();
+    pairIndex.clear();
+
+    for (int axis = 0; axis < 3; ++axis) {
+        std::vector<Endpoint>& list = endpoints[axis];
+        list.resize(bodyCount * 2);
+        for (uint32_t i = 0; i < bodyCount; ++i) {
+            list[2 * i] = { bounds[i].min[axis], i << 1 };
+            list[2 * i + 1] = { bounds[i].max[axis], (i << 1) | 1u };
+        }
+        std::sort(list.begin(), list.end(), less);
+    }
+
+    // One full sweep along x seeds the pair set; afterwards it is only
+    // updated through endpoint swaps.
+    std::vector<uint32_t> open;
+    for (const Endpoint& endpoint : endpoints[0]) {
+        uint32_t body = endpoint.body();
+        if (endpoint.isMax()) {
+            open.erase(std::find(open.begin(), open.end(), body));
+            continue;
+        }
+        for (uint32_t other : open) {
+            if (bounds[body].overlaps(bounds[other])) {
+                addPair(body, other);
+            }
+        }
+        open.push_back(body);
+    }
+    needsRebuild = false;
+}
+
+void SweepAndPrune::sortAxis(int axis, const std::vector<AABB>& bounds) {
+    std::vector<Endpoint>& list = endpoints[axis];
+    for (size_t i = 1; i < list.size(); ++i) {
+        Endpoint moving = list[i];
+        size_t j = i;
+        while (j > 0 && less(moving, list[j - 1])) {
+            const Endpoint& passed = list[j - 1];
+            if (!moving.isMax() && passed.isMax()) {
+                // A min slides below another body's max: they may start overlapping.
+                if (bounds[moving.body()].overlaps(bounds[passed.body()])) {
+                    addPair(moving.body(), passed.body());
+                }
+            } else if (moving.isMax() && !passed.isMax()) {
+                // A max slides below another body's min: they separate on this axis.
+                removePair(moving.body(), passed.body());
+            }
+            list[j] = passed;
+            --j;
+        }
+        list[j] = moving;
+    }
+}
+
+void SweepAndPrune::findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) {
+    if (needsRebuild || bounds.size() != bodyCount) {
+        rebuild(bounds);
+    } else {
+        for (int axis = 0; axis < 3; ++axis) {
+            for (Endpoint& endpoint : endpoints[axis]) {
+                const AABB& box = bounds[endpoint.body()];
+                endpoint.value = endpoint.isMax() ? box.max[axis] : box.min[axis];
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            sortAxis(axis, bounds);
+        }
+    }
+    pairs = activePairs;
+}
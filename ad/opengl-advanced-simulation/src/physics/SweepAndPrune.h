@@ -0,0 +1,45 @@
+#ifndef SWEEP_AND_PRUNE_H
+#define SWEEP_AND_PRUNE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Broadphase.h"
+
+// Incremental sweep and prune. The sorted endpoint list of every axis is kept
+// between frames, so when bodies only move a little the insertion sort does
+// close to linear work and the pair set is patched by the swaps it performs.
+// Unlike a grid it does not depend on a cell size, which suits scenes that
+// mix very small and very large bodies.
+class SweepAndPrune : public Broadphase {
+public:
+    SweepAndPrune();
+
+    void findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) override;
+    void invalidate() override;
+
+private:
+    struct Endpoint {
+        float value;
+        uint32_t data; // body index << 1 | 1 for a max endpoint
+
+        uint32_t body() const { return data >> 1; }
+        bool isMax() const { return (data & 1u) != 0; }
+    };
+
+    static bool less(const Endpoint& a, const Endpoint& b);
+    static uint64_t pairKey(uint32_t a, uint32_t b);
+
+    void rebuild(const std::vector<AABB>& bounds);
+    void sortAxis(int axis, const std::vector<AABB>& bounds);
+    void addPair(uint32_t a, uint32_t b);
+    void removePair(uint32_t a, uint32_t b);
+
+    std::vector<Endpoint> endpoints[3];
+    std::vector<BroadphasePair> activePairs;
+    std::unordered_map<uint64_t, uint32_t> pairIndex;
+    size_t bodyCount;
+    bool needsRebuild;
+};
+
+#endif // SWEEP_AND_PRUNE_H
@@ -0,0 +1,99 @@
+#include "VerletBroadphase.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+
+// Fixed chunk sizes keep the pair order independent of the thread count.
+static const uint32_t boundsPerChunk = 4096;
+static const uint32_t pairsPerChunk = 8192;
+
+VerletBroadphase::VerletBroadphase(std::unique_ptr<Broadphase> inner, float skin)
+    : inner(std::move(inner)), skin(std::max(skin, 0.0f)), valid(false), rebuilt(false), rebuildCount(0) {}
+
+void VerletBroadphase::setSkin(float newSkin) {
+    skin = std::max(newSkin, 0.0f);
+}
+
+float VerletBroadphase::getSkin() const {
+    return skin;
+}
+
+void VerletBroadphase::invalidate() {
+    // Pairs are body indices, so any change of layout voids the cache.
+    valid = false;
+    inner->invalidate();
+}
+
+void VerletBroadphase::setJobSystem(JobSystem* jobs) {
+    Broadphase::setJobSystem(jobs);
+    inner->setJobSystem(jobs);
+}
+
+Broadphase& VerletBroadphase::getInner() {
+    return *inner;
+}
+
+bool VerletBroadphase::rebuiltLastCall() const {
+    return rebuilt;
+}
+
+uint64_t VerletBroadphase::getRebuildCount() const {
+    return rebuildCount;
+}
+
+bool VerletBroadphase::needsRebuild(const std::vector<AABB>& bounds) const {
+    if (!valid || bounds.size() != fatBounds.size()) {
+        return true;
+    }
+    std::atomic<bool> escaped(false);
+    parallelFor(jobSystem, static_cast<uint32_t>(bounds.size()), boundsPerChunk, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end && !escaped.load(std::memory_order_relaxed); ++i) {
+            if (!fatBounds[i].contains(bounds[i])) {
+                escaped.store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+    return escaped.load();
+}
+
+void VerletBroadphase::rebuild(const std::vector<AABB>& bounds) {
+    glm::vec3 margin(0.5f * skin);
+    fatBounds.resize(bounds.size());
+    parallelFor(jobSystem, static_cast<uint32_t>(bounds.size()), boundsPerChunk, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            fatBounds[i] = AABB(bounds[i].min - margin, bounds[i].max + margin);
+        }
+    });
+    inner->findPairs(fatBounds, cachedPairs);
+    valid = true;
+    ++rebuildCount;
+}
+
+void VerletBroadphase::findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) {
+    rebuilt = needsRebuild(bounds);
+    if (rebuilt) {
+        rebuild(bounds);
+    }
+
+    uint32_t pairCount = static_cast<uint32_t>(cachedPairs.size());
+    uint32_t chunks = JobSystem::chunkCount(pairCount, pairsPerChunk);
+    chunkPairs.resize(chunks);
+    parallelFor(jobSystem, chunks, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; ++chunk) {
+            std::vector<BroadphasePair>& out = chunkPairs[chunk];
+            out.clear();
+            uint32_t last = std::min((chunk + 1) * pairsPerChunk, pairCount);
+            for (uint32_t k = chunk * pairsPerChunk; k < last; ++k) {
+                const BroadphasePair& pair = cachedPairs[k];
+                if (bounds[pair.a].overlaps(bounds[pair.b])) {
+                    out.push_back(pair);
+                }
+            }
+        }
+    });
+
+    pairs.clear();
+    for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+        pairs.insert(pairs.end(), chunkPairs[chunk].begin(), chunkPairs[chunk].end());
+    }
+}
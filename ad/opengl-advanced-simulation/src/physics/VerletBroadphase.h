@@ -0,0 +1,47 @@
+#ifndef VERLET_BROADPHASE_H
+#define VERLET_BROADPHASE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Broadphase.h"
+
+// Verlet list on top of another broadphase. Every box is grown by half the
+// skin and the wrapped broadphase finds the pairs of those fat boxes once;
+// later calls just filter that cached list by the real boxes. Two bodies
+// that each stayed inside their fat box can only touch if their fat boxes
+// did, so the cache is rebuilt only once some box leaves its fat box, i.e.
+// a body moved more than half the skin. The result is exactly the set of
+// overlapping pairs the wrapped broadphase would report, in cache order.
+class VerletBroadphase : public Broadphase {
+public:
+    VerletBroadphase(std::unique_ptr<Broadphase> inner, float skin);
+
+    // Takes effect at the next rebuild.
+    void setSkin(float skin);
+    float getSkin() const;
+
+    void findPairs(const std::vector<AABB>& bounds, std::vector<BroadphasePair>& pairs) override;
+    void invalidate() override;
+    void setJobSystem(JobSystem* jobs) override;
+
+    Broadphase& getInner();
+    // Whether the last findPairs had to run the wrapped broadphase.
+    bool rebuiltLastCall() const;
+    uint64_t getRebuildCount() const;
+
+private:
+    bool needsRebuild(const std::vector<AABB>& bounds) const;
+    void rebuild(const std::vector<AABB>& bounds);
+
+    std::unique_ptr<Broadphase> inner;
+    float skin;
+    bool valid;
+    bool rebuilt;
+    uint64_t rebuildCount;
+    std::vector<AABB> fatBounds;
+    std::vector<BroadphasePair> cachedPairs;
+    std::vector<std::vector<BroadphasePair>> chunkPairs;
+};
+
+#endif // VERLET_BROADPHASE_H
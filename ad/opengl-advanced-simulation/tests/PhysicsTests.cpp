@@ -0,0 +1,104 @@
+// Headless regression tests for PhysicsEngine, run by ctest. Each check
+// prints what went wrong; the exit code is the number of failed checks.
+//
+//   physics-tests
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "physics/PhysicsEngine.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (!condition) {
+        std::printf("FAILED %s: %s\n", test, what);
+        ++failures;
+    }
+}
+
+// A fast sphere falling onto a wide, thin box must stop on top of it. The
+// box's bounding sphere overlaps the sphere's from the start, so sweeping
+// bounding spheres alone let it through.
+void fastSphereHitsThinBox() {
+    const char* test = "fastSphereHitsThinBox";
+    PhysicsEngine engine;
+    engine.setContinuousCollision(true);
+    RigidBody floor(0.0f, glm::vec3(0.0f));
+    floor.setCollider(Collider::box(glm::vec3(5.0f, 0.1f, 5.0f)));
+    engine.addRigidBody(floor);
+    RigidBody ball(1.0f, glm::vec3(0.0f, 2.0f, 0.0f), 0.25f);
+    ball.setVelocity(glm::vec3(0.0f, -500.0f, 0.0f));
+    BodyHandle handle = engine.addRigidBody(ball);
+
+    float lowest = engine.getPosition(handle).y;
+    for (int step = 0; step < 10; ++step) {
+        engine.update(1.0f / 60.0f);
+        lowest = std::min(lowest, engine.getPosition(handle).y);
+    }
+    check(lowest > 0.1f, test, "sphere passed through the box");
+}
+
+// A snapshot whose positionY column is one body short, with its length
+// prefix changed to match, so every byte count still adds up.
+void snapshotWithShortColumnIsRejected() {
+    const char* test = "snapshotWithShortColumnIsRejected";
+    PhysicsEngine engine;
+    const uint64_t count = 3;
+    for (uint64_t i = 0; i < count; ++i) {
+        engine.addRigidBody(RigidBody(1.0f, glm::vec3(1.5f * (i + 1), 2.0f, 0.0f)));
+    }
+    std::vector<uint8_t> snapshot;
+    engine.saveSnapshot(snapshot);
+
+    // positionX is the first column: its length, then one float per body.
+    std::vector<uint8_t> pattern(sizeof(count) + count * sizeof(float));
+    std::memcpy(pattern.data(), &count, sizeof(count));
+    for (uint64_t i = 0; i < count; ++i) {
+        float x = 1.5f * (i + 1);
+        std::memcpy(pattern.data() + sizeof(count) + i * sizeof(float), &x, sizeof(float));
+    }
+    auto found = std::search(snapshot.begin(), snapshot.end(), pattern.begin(), pattern.end());
+    check(found != snapshot.end(), test, "positionX not found in the snapshot");
+    if (found == snapshot.end()) {
+        return;
+    }
+    size_t positionY = (found - snapshot.begin()) + pattern.size();
+    uint64_t shorter = count - 1;
+    std::memcpy(snapshot.data() + positionY, &shorter, sizeof(shorter));
+    snapshot.erase(snapshot.begin() + positionY + sizeof(shorter) + shorter * sizeof(float),
+                   snapshot.begin() + positionY + sizeof(shorter) + count * sizeof(float));
+
+    check(!engine.loadSnapshot(snapshot), test, "damaged snapshot was loaded");
+    check(engine.getBodyCount() == count, test, "failed load changed the engine");
+}
+
+// Rays starting outside a sphere only hit it in front of the origin.
+void raycastPointingAwayFromSphereMisses() {
+    const char* test = "raycastPointingAwayFromSphereMisses";
+    PhysicsEngine engine;
+    engine.addRigidBody(RigidBody(1.0f, glm::vec3(0.0f), 1.0f));
+    RaycastHit hit;
+    check(!engine.raycast(glm::vec3(1.05f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 100.0f, hit), test,
+          "ray pointing away hit the sphere");
+    bool toward = engine.raycast(glm::vec3(3.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), 100.0f, hit);
+    check(toward && std::abs(hit.distance - 2.0f) < 1e-4f, test, "ray pointing at the sphere missed its surface");
+    bool inside = engine.raycast(glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 100.0f, hit);
+    check(inside && hit.distance == 0.0f, test, "ray from inside the sphere did not hit at once");
+}
+
+} // namespace
+
+int main() {
+    fastSphereHitsThinBox();
+    snapshotWithShortColumnIsRejected();
+    raycastPointingAwayFromSphereMisses();
+    if (failures == 0) {
+        std::printf("all physics tests passed\n");
+    }
+    return failures;
+}
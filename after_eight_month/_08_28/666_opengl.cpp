@@ -7,6 +7,8 @@
 #include <vector>
 #include <random>
 #include <cmath>
+#include "../../learning_opengl/worker_pool.h"
+#include "depth_sort.h"
 
 // 粒子计算着色器
 const char* particleComputeShaderSource = R"(
@@ -76,9 +78,12 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
+flat out uint vIndex;
 
 void main() {
     TexCoord = aTexCoord;
+    // glDrawElements 时 gl_VertexID 就是索引缓冲里的粒子下标
+    vIndex = uint(gl_VertexID);
     gl_Position = vec4(aPos, 1.0);
 }
 )";
@@ -91,6 +96,7 @@ layout(points) in;
 layout(triangle_strip, max_vertices = 4) out;
 
 in vec2 TexCoord[];
+flat in uint vIndex[];
 
 out vec2 oTexCoord;
 out vec4 oColor;
@@ -114,7 +120,7 @@ uniform mat4 projection;
 uniform float time;
 
 void main() {
-    uint index = uint(gl_PrimitiveIDIn);
+    uint index = vIndex[0];
     Particle p = particles[index];
     
     if (p.life <= 0.0) return;
@@ -191,7 +197,8 @@ void main() {
     float glow = exp(-length(oPosition) * 5.0) * 0.5;
     color += vec3(glow * oColor.r, glow * oColor.g, glow * oColor.b);
     
-    FragColor = vec4(color, alpha * oColor.a);
+    // 预乘 alpha 输出, 配合 (ONE, ONE_MINUS_SRC_ALPHA) 从远到近叠加, 辉光部分仍是加亮
+    FragColor = vec4(color * oColor.a, alpha * oColor.a);
 }
 )";
 
@@ -311,20 +318,29 @@ class ParticleSystem {
 public:
     static const int PARTICLE_COUNT = 10000;
     
+    // 与着色器中 std430 布局一致: 三个 vec4 加两个 float, 补齐到 16 字节的倍数, 步长 64 字节
     struct Particle {
         glm::vec4 position;
         glm::vec4 velocity;
         glm::vec4 color;
         float life;
         float maxLife;
+        float padding[2];
     };
     
     unsigned int computeProgram;
     unsigned int renderProgram;
     unsigned int ssbo;
+    unsigned int vao;
+    unsigned int ebo;       // 从远到近的粒子下标
+    unsigned int readback[2];   // 轮流接收 SSBO 的拷贝, 排序读的是上一帧那份
+    GLsync readbackFence[2];
+    int readbackIndex;          // 这一帧拷进哪一份
     Particle particles[PARTICLE_COUNT];
+    WorkerPool workers;
+    DepthSorter sorter;
     
-    ParticleSystem() {
+    ParticleSystem() : readbackIndex(0), sorter(workers) {
         // 初始化粒子
         std::random_device rd;
         std::mt19937 gen(rd());
@@ -338,6 +354,7 @@ public:
             particles[i].color = glm::vec4(0.5f, 0.7f, 1.0f, 1.0f);
             particles[i].life = lifeDist(gen);
             particles[i].maxLife = particles[i].life;
+            particles[i].padding[0] = particles[i].padding[1] = 0.0f;
         }
         
         // 创建着色器程序
@@ -349,6 +366,24 @@ public:
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
         glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Particle) * PARTICLE_COUNT, particles, GL_DYNAMIC_DRAW);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        
+        // 粒子没有顶点属性, VAO 只记录索引缓冲
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * PARTICLE_COUNT, nullptr, GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+        
+        // 两份回读缓冲: GPU 每帧把 SSBO 拷进其中一份, CPU 映射另一份 (上一帧的拷贝) 来排序,
+        // 这时那次拷贝早已完成, CPU 不用停下来等 GPU 算完这一帧; 开始时两份都是初始粒子
+        glGenBuffers(2, readback);
+        for (int i = 0; i < 2; ++i) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, readback[i]);
+            glBufferData(GL_COPY_WRITE_BUFFER, sizeof(Particle) * PARTICLE_COUNT, particles, GL_STREAM_READ);
+            readbackFence[i] = nullptr;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
     }
     
     void update(float deltaTime, float time) {
@@ -359,10 +394,40 @@ public:
         glUniform1f(glGetUniformLocation(computeProgram, "time"), time);
         glUniform3f(glGetUniformLocation(computeProgram, "emitterPosition"), 0.0f, 0.0f, 0.0f);
         glDispatchCompute((PARTICLE_COUNT + 255) / 256, 1, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        // 绘制要读 SSBO, 下面的拷贝也要读
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        
+        // 在 GPU 上拷进回读缓冲, 下一帧排序时再映射读取
+        glBindBuffer(GL_COPY_READ_BUFFER, ssbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, readback[readbackIndex]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(Particle) * PARTICLE_COUNT);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (readbackFence[readbackIndex]) {
+            glDeleteSync(readbackFence[readbackIndex]);
+        }
+        readbackFence[readbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     }
     
     void render(const glm::mat4& view, const glm::mat4& projection, float time) {
+        // 按上一帧拷出的位置从远到近排序, 作为索引缓冲; 晚一帧只影响这期间刚重生的粒子
+        int previous = 1 - readbackIndex;
+        if (readbackFence[previous]) {
+            glClientWaitSync(readbackFence[previous], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, readback[previous]);
+        const Particle* latest = static_cast<const Particle*>(
+            glMapBufferRange(GL_COPY_READ_BUFFER, 0, sizeof(Particle) * PARTICLE_COUNT, GL_MAP_READ_BIT));
+        if (latest) {
+            const std::vector<uint32_t>& order = sorter.sort(PARTICLE_COUNT, view,
+                                                             [latest](int i) { return glm::vec3(latest[i].position); });
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glBindVertexArray(vao);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint32_t) * order.size(), order.data());
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        readbackIndex = previous;
+        
         glUseProgram(renderProgram);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
         glUniformMatrix4fv(glGetUniformLocation(renderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
@@ -370,11 +435,13 @@ public:
         glUniform1f(glGetUniformLocation(renderProgram, "time"), time);
         
         glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
         glDepthMask(GL_FALSE);
         
-        // 绘制粒子
-        glDrawArrays(GL_POINTS, 0, PARTICLE_COUNT);
+        // 按排好的顺序绘制粒子
+        glBindVertexArray(vao);
+        glDrawElements(GL_POINTS, PARTICLE_COUNT, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
         
         glDepthMask(GL_TRUE);
         glDisable(GL_BLEND);
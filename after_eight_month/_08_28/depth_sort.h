@@ -0,0 +1,201 @@
+#ifndef DEPTH_SORT_H
+#define DEPTH_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../learning_opengl/worker_pool.h"
+
+// 半透明粒子的深度排序: 视线深度按本帧的最近/最远范围量化成 16 位键,
+// 多线程 LSD 基数排序 (两趟, 每趟 8 位), 输出从远到近的粒子下标, 直接作为索引缓冲上传
+// 每 CHUNK_SIZE 个元素一块, 各块单独统计直方图, 再按 (桶, 块) 的顺序求前缀和,
+// 每块只写属于自己的位置, 不需要加锁; 排序是稳定的, 结果与线程数无关
+//
+// 增量模式: 粒子下标跨帧不变 (例如 666_opengl.cpp 里位置固定在 SSBO 中的粒子), 且相机和粒子
+// 每帧移动不超过一两个量化档时, 按上一帧的顺序重新算键后数组几乎有序, 先做插入排序,
+// 移动次数超过预算时再退回基数排序. 基数排序对任意输入顺序都成立, 插入排序做到一半的结果可以直接接着用
+// 每帧都重排粒子下标的输入 (例如 water_liked.cpp 里按单元重排的 SPH 粒子) 上一帧的顺序毫无意义,
+// 只会白做一次插入排序, 要用 setIncremental(false) 关掉
+class DepthSorter {
+public:
+    static const int CHUNK_SIZE = 16384;
+
+    explicit DepthSorter(WorkerPool& pool) : pool(pool) {}
+
+    void setIncremental(bool enabled) {
+        incremental = enabled;
+    }
+
+    bool isIncremental() const {
+        return incremental;
+    }
+
+    // 上一次 sort 是否只靠插入排序就完成了
+    bool lastSortWasIncremental() const {
+        return reusedOrder;
+    }
+
+    // 对粒子 0..count-1 排序, positionOf(i) 返回粒子 i 的世界坐标
+    // 增量模式下粒子数可以变化: 超出范围的旧下标被去掉, 新下标接在末尾
+    template <typename PositionOf>
+    const std::vector<uint32_t>& sort(int count, const glm::mat4& view, PositionOf positionOf) {
+        bool reuse = incremental && !order.empty();
+        if (reuse) {
+            adoptPreviousOrder(count);
+        } else {
+            order.resize(count);
+            for (int i = 0; i < count; ++i) {
+                order[i] = static_cast<uint32_t>(i);
+            }
+        }
+        depths.resize(count);
+        entries.resize(count);
+        scratch.resize(count);
+        int chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunkMin.assign(chunkCount, 0.0f);
+        chunkMax.assign(chunkCount, 0.0f);
+
+        // 观察空间的 z, 越小越远; 按粒子下标顺序读位置, 不随 order 跳着读
+        glm::vec4 row(view[0][2], view[1][2], view[2][2], view[3][2]);
+        pool.run(count, CHUNK_SIZE, [&](int begin, int end) {
+            float lowest = std::numeric_limits<float>::max();
+            float highest = -std::numeric_limits<float>::max();
+            for (int i = begin; i < end; ++i) {
+                glm::vec3 p = positionOf(i);
+                float z = row.x * p.x + row.y * p.y + row.z * p.z + row.w;
+                depths[i] = z;
+                lowest = std::min(lowest, z);
+                highest = std::max(highest, z);
+            }
+            chunkMin[begin / CHUNK_SIZE] = lowest;
+            chunkMax[begin / CHUNK_SIZE] = highest;
+        });
+        if (count == 0) {
+            reusedOrder = reuse;
+            return order;
+        }
+        float minDepth = *std::min_element(chunkMin.begin(), chunkMin.end());
+        float maxDepth = *std::max_element(chunkMax.begin(), chunkMax.end());
+        // 增量模式下量化范围尽量沿用上一帧 (留 5% 余量), 否则范围一变所有键都会重新取整,
+        // 同一档里原本无序的粒子被拆开, 插入排序就要移动很多次
+        bool keepRange = reuse && minDepth >= rangeMin && maxDepth <= rangeMax &&
+                         maxDepth - minDepth >= 0.5f * (rangeMax - rangeMin);
+        if (!keepRange) {
+            float margin = reuse ? 0.05f * (maxDepth - minDepth) : 0.0f;
+            rangeMin = minDepth - margin;
+            rangeMax = maxDepth + margin;
+        }
+        float scale = rangeMax > rangeMin ? 65535.0f / (rangeMax - rangeMin) : 0.0f;
+
+        // 键放高 32 位, 下标放低 32 位, 基数排序每趟只搬一个数组
+        pool.run(count, CHUNK_SIZE, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                uint32_t index = order[i];
+                uint64_t key = static_cast<uint64_t>(std::min((depths[index] - rangeMin) * scale, 65535.0f));
+                entries[i] = (key << 32) | index;
+            }
+        });
+
+        reusedOrder = reuse && insertionSort(count, count);
+        if (!reusedOrder) {
+            radixPass(count, 32);
+            radixPass(count, 40);
+        }
+        pool.run(count, CHUNK_SIZE, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                order[i] = static_cast<uint32_t>(entries[i]);
+            }
+        });
+        return order;
+    }
+
+private:
+    // 上一帧的顺序去掉 >= count 的下标, 再补上新增的下标, 仍是 0..count-1 的一个排列
+    void adoptPreviousOrder(int count) {
+        int previous = static_cast<int>(order.size());
+        if (previous > count) {
+            order.erase(std::remove_if(order.begin(), order.end(),
+                                       [count](uint32_t index) { return index >= static_cast<uint32_t>(count); }),
+                        order.end());
+        }
+        for (int i = previous; i < count; ++i) {
+            order.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    // 只比较键, 保持上一帧的相对顺序; 移动次数超过 budget 时放弃, 返回 false, 放弃时数组仍是完整的排列
+    bool insertionSort(int count, long long budget) {
+        for (int i = 1; i < count; ++i) {
+            uint64_t entry = entries[i];
+            uint64_t key = entry >> 32;
+            if ((entries[i - 1] >> 32) <= key) {
+                continue;
+            }
+            int j = i;
+            while (j > 0 && (entries[j - 1] >> 32) > key) {
+                entries[j] = entries[j - 1];
+                --j;
+                if (--budget < 0) {
+                    break;
+                }
+            }
+            entries[j] = entry;
+            if (budget < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 按 entries 的第 shift..shift+7 位做一趟稳定的计数排序
+    void radixPass(int count, int shift) {
+        int chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        histograms.assign(static_cast<size_t>(chunkCount) * 256, 0);
+        pool.run(count, CHUNK_SIZE, [&](int begin, int end) {
+            int* histogram = &histograms[static_cast<size_t>(begin / CHUNK_SIZE) * 256];
+            for (int i = begin; i < end; ++i) {
+                ++histogram[(entries[i] >> shift) & 0xFF];
+            }
+        });
+
+        // 桶在前, 块在后: 同一桶里靠前的块先写, 保持稳定; 所有元素落在同一个桶时这一趟可以跳过
+        int offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            int bucketStart = offset;
+            for (int c = 0; c < chunkCount; ++c) {
+                int& slot = histograms[static_cast<size_t>(c) * 256 + bucket];
+                int n = slot;
+                slot = offset;
+                offset += n;
+            }
+            if (offset - bucketStart == count) {
+                return;
+            }
+        }
+
+        pool.run(count, CHUNK_SIZE, [&](int begin, int end) {
+            int* cursor = &histograms[static_cast<size_t>(begin / CHUNK_SIZE) * 256];
+            for (int i = begin; i < end; ++i) {
+                scratch[cursor[(entries[i] >> shift) & 0xFF]++] = entries[i];
+            }
+        });
+        entries.swap(scratch);
+    }
+
+    WorkerPool& pool;
+    bool incremental = true;
+    bool reusedOrder = false;
+    float rangeMin = 0.0f;  // 量化范围
+    float rangeMax = 0.0f;
+    std::vector<uint32_t> order;    // 从远到近的粒子下标
+    std::vector<float> depths;      // 按粒子下标
+    std::vector<uint64_t> entries;  // 16 位键 << 32 | 粒子下标
+    std::vector<uint64_t> scratch;
+    std::vector<float> chunkMin;
+    std::vector<float> chunkMax;
+    std::vector<int> histograms;    // 每块 256 个桶
+};
+
+#endif // DEPTH_SORT_H
@@ -3,117 +3,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 #include <iostream>
 #include <vector>
 #include <random>
 #include <cmath>
-
-// 水流计算着色器
-const char* waterComputeShaderSource = R"(
-#version 430 core
-
-struct WaterParticle {
-    vec4 position;
-    vec4 velocity;
-    vec4 color;
-    float life;
-    float maxLife;
-    float density;
-};
-
-layout(std430, binding = 0) buffer ParticleBuffer {
-    WaterParticle particles[];
-};
-
-uniform float deltaTime;
-uniform float time;
-uniform vec3 emitterPosition;
-uniform vec3 gravity;
-
-void main() {
-    uint index = gl_GlobalInvocationID.x;
-    
-    if (index >= gl_NumWorkGroups.x * gl_WorkGroupSize.x) return;
-    
-    WaterParticle p = particles[index];
-    
-    // 更新生命周期
-    p.life -= deltaTime;
-    
-    if (p.life <= 0.0) {
-        // 重置死亡粒子
-        p.position = vec4(emitterPosition + vec3(
-            (float(randivec3(gl_GlobalInvocationID.xyy).x) / float(0x7fffffff)) * 2.0 - 1.0,
-            (float(randivec3(gl_GlobalInvocationID.xyx).y) / float(0x7fffffff)) * 2.0 - 1.0,
-            (float(randivec3(gl_GlobalInvocationID.yxy).z) / float(0x7fffffff)) * 2.0 - 1.0
-        ) * 0.5, 1.0);
-        
-        p.velocity = vec4(0.0, 0.0, 0.0, 0.0);
-        p.color = vec4(0.2, 0.4, 1.0, 0.7);
-        p.life = p.maxLife = 3.0 + (float(randivec3(gl_GlobalInvocationID.xxx).x) / float(0x7fffffff)) * 2.0;
-        p.density = 1.0;
-    } else {
-        // 更新存活粒子
-        // 应用重力
-        p.velocity.xyz += gravity * deltaTime;
-        
-        // 水流相互作用
-        vec3 force = vec3(0.0);
-        for (int i = 0; i < 10; i++) {
-            uint otherIndex = (index + i * 100) % (gl_NumWorkGroups.x * gl_WorkGroupSize.x);
-            if (otherIndex != index) {
-                WaterParticle other = particles[otherIndex];
-                vec3 diff = p.position.xyz - other.position.xyz;
-                float dist = length(diff);
-                if (dist > 0.0 && dist < 1.0) {
-                    float strength = 0.5 / (dist + 0.1);
-                    force -= normalize(diff) * strength * other.density;
-                }
-            }
-        }
-        
-        // 应用流体动力学力
-        p.velocity.xyz += force * deltaTime;
-        
-        // 限制最大速度
-        float maxSpeed = 10.0;
-        if (length(p.velocity.xyz) > maxSpeed) {
-            p.velocity.xyz = normalize(p.velocity.xyz) * maxSpeed;
-        }
-        
-        // 更新位置
-        p.position.xyz += p.velocity.xyz * deltaTime;
-        
-        // 碰撞检测 - 地面
-        if (p.position.y < -5.0) {
-            p.position.y = -5.0;
-            p.velocity.y *= -0.3; // 弹跳
-            p.velocity.x *= 0.8;  // 摩擦
-            p.velocity.z *= 0.8;  // 摩擦
-        }
-        
-        // 碰撞检测 - 墙壁
-        if (p.position.x < -10.0 || p.position.x > 10.0) {
-            p.velocity.x *= -0.5;
-            p.position.x = clamp(p.position.x, -10.0, 10.0);
-        }
-        if (p.position.z < -10.0 || p.position.z > 10.0) {
-            p.velocity.z *= -0.5;
-            p.position.z = clamp(p.position.z, -10.0, 10.0);
-        }
-        
-        // 颜色随速度变化
-        float speed = length(p.velocity.xyz);
-        p.color = vec4(0.2 + speed * 0.02, 0.4 + speed * 0.01, 0.8 + speed * 0.03, 0.6 + speed * 0.02);
-        
-        // 透明度随生命周期变化
-        float lifeRatio = p.life / p.maxLife;
-        p.color.a = lifeRatio < 0.2 ? lifeRatio * 5.0 : 1.0;
-    }
-    
-    particles[index] = p;
-}
-)";
+#include <algorithm>
+#include "../../learning_opengl/worker_pool.h"
+#include "depth_sort.h"
 
 // 水流渲染顶点着色器
 const char* waterVertexShaderSource = R"(
@@ -123,9 +20,12 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
+flat out uint vIndex;
 
 void main() {
     TexCoord = aTexCoord;
+    // glDrawElements 时 gl_VertexID 就是索引缓冲里的粒子下标
+    vIndex = uint(gl_VertexID);
     gl_Position = vec4(aPos, 1.0);
 }
 )";
@@ -138,6 +38,7 @@ layout(points) in;
 layout(triangle_strip, max_vertices = 4) out;
 
 in vec2 TexCoord[];
+flat in uint vIndex[];
 
 out vec2 oTexCoord;
 out vec4 oColor;
@@ -162,7 +63,7 @@ uniform mat4 projection;
 uniform float time;
 
 void main() {
-    uint index = uint(gl_PrimitiveIDIn);
+    uint index = vIndex[0];
     WaterParticle p = particles[index];
     
     if (p.life <= 0.0) return;
@@ -380,70 +281,412 @@ unsigned int createShaderProgram(const char* vertexSource, const char* fragmentS
     return program;
 }
 
-// 水流粒子系统类
+// 与着色器中 std430 布局一致: 三个 vec4 加三个 float, 结构体按 16 字节对齐, 步长 64 字节
+struct WaterParticle {
+    glm::vec4 position;
+    glm::vec4 velocity;
+    glm::vec4 color;
+    float life;
+    float maxLife;
+    float density;
+    float padding;
+};
+
+// CPU 上的 SPH 流体 (弱可压缩, Müller 2003 核函数)
+// 粒子按 SoA 存放, 每个子步按网格单元计数排序, 同一单元的粒子在内存中连续,
+// 邻居搜索只需扫描 9 段连续区间 (x 方向相邻的三个单元是挨着的)
+class SPHFluid {
+public:
+    // 粒子间距 0.1 米, 光滑半径取两倍间距, 每个粒子约 30 个邻居
+    static constexpr float spacing = 0.1f;
+    static constexpr float smoothingRadius = 2.0f * spacing;
+    static constexpr float particleMass = 1000.0f * spacing * spacing * spacing;
+    static constexpr float stiffness = 400.0f;   // 声速 20 m/s 的平方
+    static constexpr float viscosity = 0.02f;
+    static constexpr float substep = 1.0f / 240.0f;
+    static constexpr int maxSubsteps = 8;
+
+    SPHFluid(int capacity, WorkerPool& pool) : capacity(capacity), pool(pool), gen(12345) {
+        for (std::vector<float>* field : fields()) {
+            field->assign(capacity, 0.0f);
+        }
+        density.assign(capacity, 0.0f);
+        pressureTerm.assign(capacity, 0.0f);
+        inverseDensity.assign(capacity, 0.0f);
+        accelerationX.assign(capacity, 0.0f);
+        accelerationY.assign(capacity, 0.0f);
+        accelerationZ.assign(capacity, 0.0f);
+        cellOf.assign(capacity, 0);
+        order.assign(capacity, 0);
+        scratch.assign(capacity, 0.0f);
+
+        float h = smoothingRadius;
+        poly6 = 315.0f / (64.0f * glm::pi<float>() * std::pow(h, 9.0f));
+        spikyGradient = -45.0f / (glm::pi<float>() * std::pow(h, 6.0f));
+        viscosityLaplacian = 45.0f / (glm::pi<float>() * std::pow(h, 6.0f));
+
+        // 静止密度取规则格点内部粒子的核函数求和, 这样刚发射的格点层没有压力
+        restDensity = 0.0f;
+        for (int x = -2; x <= 2; ++x) {
+            for (int y = -2; y <= 2; ++y) {
+                for (int z = -2; z <= 2; ++z) {
+                    float r2 = (x * x + y * y + z * z) * spacing * spacing;
+                    if (r2 < h * h) {
+                        float d = h * h - r2;
+                        restDensity += particleMass * poly6 * d * d * d;
+                    }
+                }
+            }
+        }
+
+        gridX = static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / h));
+        gridY = static_cast<int>(std::ceil((boundsMax.y - boundsMin.y) / h));
+        gridZ = static_cast<int>(std::ceil((boundsMax.z - boundsMin.z) / h));
+        cellCount = gridX * gridY * gridZ;
+        cellStart.assign(cellCount + 2, 0);
+    }
+
+    // 按固定子步推进, 帧时间过长时丢弃多余部分
+    void update(float frameTime) {
+        accumulator = std::min(accumulator + frameTime, maxSubsteps * substep);
+        while (accumulator >= substep) {
+            step(substep);
+            accumulator -= substep;
+        }
+    }
+
+    void step(float dt) {
+        emit(dt);
+        sortByCell();
+        computeDensity();
+        computeForces();
+        integrate(dt);
+    }
+
+    int getActiveCount() const {
+        return activeCount;
+    }
+
+    glm::vec3 getPosition(int i) const {
+        return glm::vec3(positionX[i], positionY[i], positionZ[i]);
+    }
+
+    // 直接写入 SSBO 映射出来的内存, 未激活的粒子 life 为 0, 几何着色器会跳过
+    void writeParticles(WaterParticle* out) {
+        pool.run(capacity, 4096, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                WaterParticle& p = out[i];
+                glm::vec3 velocity(velocityX[i], velocityY[i], velocityZ[i]);
+                float speed = glm::length(velocity);
+                float lifeRatio = maxLife[i] > 0.0f ? life[i] / maxLife[i] : 0.0f;
+                p.position = glm::vec4(positionX[i], positionY[i], positionZ[i], 1.0f);
+                p.velocity = glm::vec4(velocity, 0.0f);
+                // 颜色随速度变化, 快死亡时淡出
+                p.color = glm::vec4(0.2f + speed * 0.02f, 0.4f + speed * 0.01f, 0.8f + speed * 0.03f,
+                                    lifeRatio < 0.2f ? lifeRatio * 5.0f : 1.0f);
+                p.life = std::max(life[i], 0.0f);
+                p.maxLife = maxLife[i];
+                p.density = restDensity > 0.0f ? density[i] / restDensity : 0.0f;
+                p.padding = 0.0f;
+            }
+        });
+    }
+
+private:
+    std::vector<std::vector<float>*> fields() {
+        return { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &life, &maxLife };
+    }
+
+    // 水龙头: 出水口每前进一个粒子间距, 就在出口平面放一层格点粒子, 刚好是静止密度
+    void emit(float dt) {
+        emitDistance += emitSpeed * dt;
+        std::uniform_real_distribution<float> jitter(-0.05f * spacing, 0.05f * spacing);
+        std::uniform_real_distribution<float> lifeDist(7.0f, 10.0f);
+        int side = static_cast<int>(emitterSize / spacing);
+        int slot = activeCount;
+        while (emitDistance >= spacing) {
+            emitDistance -= spacing;
+            if (slot + side * side > capacity) {
+                continue;
+            }
+            for (int a = 0; a < side; ++a) {
+                for (int b = 0; b < side; ++b, ++slot) {
+                    positionX[slot] = emitterPosition.x + (a - 0.5f * (side - 1)) * spacing + jitter(gen);
+                    positionY[slot] = emitterPosition.y - emitDistance + jitter(gen);
+                    positionZ[slot] = emitterPosition.z + (b - 0.5f * (side - 1)) * spacing + jitter(gen);
+                    velocityX[slot] = 0.0f;
+                    velocityY[slot] = -emitSpeed;
+                    velocityZ[slot] = 0.0f;
+                    life[slot] = maxLife[slot] = lifeDist(gen);
+                }
+            }
+        }
+    }
+
+    int cellCoordinate(float value, float minimum, int count) const {
+        int c = static_cast<int>((value - minimum) / smoothingRadius);
+        return std::min(std::max(c, 0), count - 1);
+    }
+
+    // 计数排序: 死亡粒子的键是 cellCount, 排到最后, 活着的粒子按单元连续存放
+    void sortByCell() {
+        pool.run(capacity, 8192, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                if (life[i] <= 0.0f) {
+                    cellOf[i] = cellCount;
+                    continue;
+                }
+                int x = cellCoordinate(positionX[i], boundsMin.x, gridX);
+                int y = cellCoordinate(positionY[i], boundsMin.y, gridY);
+                int z = cellCoordinate(positionZ[i], boundsMin.z, gridZ);
+                cellOf[i] = (z * gridY + y) * gridX + x;
+            }
+        });
+
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        for (int i = 0; i < capacity; ++i) {
+            ++cellStart[cellOf[i] + 1];
+        }
+        for (int c = 0; c <= cellCount; ++c) {
+            cellStart[c + 1] += cellStart[c];
+        }
+        activeCount = cellStart[cellCount];
+        // 借用 cellStart 做写入游标, 完成后再退回一格恢复成起始下标
+        for (int i = 0; i < capacity; ++i) {
+            order[cellStart[cellOf[i]]++] = i;
+        }
+        for (int c = cellCount; c > 0; --c) {
+            cellStart[c] = cellStart[c - 1];
+        }
+        cellStart[0] = 0;
+
+        for (std::vector<float>* field : fields()) {
+            pool.run(capacity, 8192, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    scratch[i] = (*field)[order[i]];
+                }
+            });
+            field->swap(scratch);
+        }
+    }
+
+    // 对粒子 i 周围 27 个单元调用 visit(begin, end), x 方向相邻的三个单元在内存中连续, 共 9 段区间
+    template <typename Visit>
+    void forEachNeighborRange(int i, Visit visit) const {
+        int x = cellCoordinate(positionX[i], boundsMin.x, gridX);
+        int y = cellCoordinate(positionY[i], boundsMin.y, gridY);
+        int z = cellCoordinate(positionZ[i], boundsMin.z, gridZ);
+        int x0 = std::max(x - 1, 0);
+        int x1 = std::min(x + 1, gridX - 1);
+        for (int nz = std::max(z - 1, 0); nz <= std::min(z + 1, gridZ - 1); ++nz) {
+            for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, gridY - 1); ++ny) {
+                int row = (nz * gridY + ny) * gridX;
+                visit(cellStart[row + x0], cellStart[row + x1 + 1]);
+            }
+        }
+    }
+
+    void computeDensity() {
+        const float h2 = smoothingRadius * smoothingRadius;
+        const float* px = positionX.data();
+        const float* py = positionY.data();
+        const float* pz = positionZ.data();
+        pool.run(activeCount, 1024, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                float sum = 0.0f;
+                forEachNeighborRange(i, [&](int first, int last) {
+                    for (int j = first; j < last; ++j) {
+                        float dx = px[i] - px[j];
+                        float dy = py[i] - py[j];
+                        float dz = pz[i] - pz[j];
+                        float r2 = dx * dx + dy * dy + dz * dz;
+                        if (r2 < h2) {
+                            float d = h2 - r2;
+                            sum += d * d * d;
+                        }
+                    }
+                });
+                density[i] = particleMass * poly6 * sum;
+                // 只保留正压力, 避免粒子在自由表面互相吸引结团
+                float p = std::max(stiffness * (density[i] - restDensity), 0.0f);
+                pressureTerm[i] = p / (density[i] * density[i]);
+                inverseDensity[i] = 1.0f / density[i];
+            }
+        });
+    }
+
+    void computeForces() {
+        const float h2 = smoothingRadius * smoothingRadius;
+        const float* px = positionX.data();
+        const float* py = positionY.data();
+        const float* pz = positionZ.data();
+        const float* vx = velocityX.data();
+        const float* vy = velocityY.data();
+        const float* vz = velocityZ.data();
+        const float* pressures = pressureTerm.data();
+        const float* inverse = inverseDensity.data();
+        const float viscosityScale = viscosity * viscosityLaplacian;
+        pool.run(activeCount, 1024, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                float fx = 0.0f, fy = 0.0f, fz = 0.0f;
+                forEachNeighborRange(i, [&](int first, int last) {
+                    for (int j = first; j < last; ++j) {
+                        float dx = px[i] - px[j];
+                        float dy = py[i] - py[j];
+                        float dz = pz[i] - pz[j];
+                        float r2 = dx * dx + dy * dy + dz * dz;
+                        if (r2 >= h2 || r2 <= 0.0f) {
+                            continue;
+                        }
+                        float r = std::sqrt(r2);
+                        float q = smoothingRadius - r;
+                        // 对称压力项保证动量守恒
+                        float pressureScale = -(pressures[i] + pressures[j]) * spikyGradient * q * q / r;
+                        float viscous = viscosityScale * q * inverse[j];
+                        fx += pressureScale * dx + viscous * (vx[j] - vx[i]);
+                        fy += pressureScale * dy + viscous * (vy[j] - vy[i]);
+                        fz += pressureScale * dz + viscous * (vz[j] - vz[i]);
+                    }
+                });
+                accelerationX[i] = particleMass * fx;
+                accelerationY[i] = particleMass * fy;
+                accelerationZ[i] = particleMass * fz;
+            }
+        });
+    }
+
+    void integrate(float dt) {
+        pool.run(activeCount, 4096, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                glm::vec3 v(velocityX[i], velocityY[i], velocityZ[i]);
+                v += (glm::vec3(accelerationX[i], accelerationY[i], accelerationZ[i]) + gravity) * dt;
+                // 限速, 保证单个子步移动不超过半个光滑半径
+                float speed = glm::length(v);
+                if (speed > maxSpeed) {
+                    v *= maxSpeed / speed;
+                }
+                glm::vec3 p = glm::vec3(positionX[i], positionY[i], positionZ[i]) + v * dt;
+
+                // 碰撞检测 - 地面与墙壁
+                if (p.y < floorHeight) {
+                    p.y = floorHeight;
+                    v.y *= -0.3f; // 弹跳
+                    v.x *= 0.8f;  // 摩擦
+                    v.z *= 0.8f;
+                }
+                if (p.x < -wallDistance || p.x > wallDistance) {
+                    p.x = glm::clamp(p.x, -wallDistance, wallDistance);
+                    v.x *= -0.5f;
+                }
+                if (p.z < -wallDistance || p.z > wallDistance) {
+                    p.z = glm::clamp(p.z, -wallDistance, wallDistance);
+                    v.z *= -0.5f;
+                }
+
+                positionX[i] = p.x;
+                positionY[i] = p.y;
+                positionZ[i] = p.z;
+                velocityX[i] = v.x;
+                velocityY[i] = v.y;
+                velocityZ[i] = v.z;
+                life[i] -= dt;
+            }
+        });
+    }
+
+    const glm::vec3 gravity = glm::vec3(0.0f, -9.8f, 0.0f);
+    const glm::vec3 emitterPosition = glm::vec3(0.0f, 5.0f, 0.0f);
+    const float emitterSize = 2.0f;
+    const float emitSpeed = 6.0f;
+    const float maxSpeed = 0.5f * smoothingRadius / substep;
+    const float floorHeight = -5.0f;
+    const float wallDistance = 10.0f;
+    // 网格覆盖的范围, 跑出范围的粒子归到边界单元, 仍然按真实距离判断邻居
+    const glm::vec3 boundsMin = glm::vec3(-10.0f, -5.0f, -10.0f);
+    const glm::vec3 boundsMax = glm::vec3(10.0f, 10.0f, 10.0f);
+
+    int capacity;
+    WorkerPool& pool;
+    std::mt19937 gen;
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> accelerationX, accelerationY, accelerationZ;
+    std::vector<float> density;
+    std::vector<float> pressureTerm;   // p / ρ², 压力项里直接相加
+    std::vector<float> inverseDensity;
+    std::vector<float> life, maxLife;
+    std::vector<int> cellOf;
+    std::vector<int> order;
+    std::vector<int> cellStart;
+    std::vector<float> scratch;
+    int gridX = 0, gridY = 0, gridZ = 0;
+    int cellCount = 0;
+    int activeCount = 0;
+    float restDensity = 0.0f;
+    float poly6 = 0.0f;
+    float spikyGradient = 0.0f;
+    float viscosityLaplacian = 0.0f;
+    float emitDistance = 0.0f;
+    float accumulator = 0.0f;
+};
+
+// 水流粒子系统类: 模拟在 CPU 上完成, 每帧把结果写进 SSBO 交给几何着色器绘制
 class WaterParticleSystem {
 public:
-    static const int PARTICLE_COUNT = 8000;
-    
-    struct WaterParticle {
-        glm::vec4 position;
-        glm::vec4 velocity;
-        glm::vec4 color;
-        float life;
-        float maxLife;
-        float density;
-    };
-    
-    unsigned int computeProgram;
+    static const int PARTICLE_COUNT = 200000;
+    
     unsigned int renderProgram;
     unsigned int ssbo;
-    WaterParticle particles[PARTICLE_COUNT];
-    
-    WaterParticleSystem() {
-        // 初始化粒子
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> posDist(-1.0f, 1.0f);
-        std::uniform_real_distribution<float> lifeDist(2.0f, 4.0f);
-        
-        for (int i = 0; i < PARTICLE_COUNT; ++i) {
-            particles[i].position = glm::vec4(0.0f, 5.0f, 0.0f, 1.0f);
-            particles[i].velocity = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-            particles[i].color = glm::vec4(0.2f, 0.4f, 1.0f, 0.7f);
-            particles[i].life = lifeDist(gen);
-            particles[i].maxLife = particles[i].life;
-            particles[i].density = 1.0f;
-        }
-        
-        // 创建着色器程序
-        unsigned int computeShader = compileShader(waterComputeShaderSource, GL_COMPUTE_SHADER);
-        computeProgram = glCreateProgram();
-        glAttachShader(computeProgram, computeShader);
-        glLinkProgram(computeProgram);
-        glDeleteShader(computeShader);
+    unsigned int vao;
+    unsigned int ebo;       // 从远到近的粒子下标
+    WorkerPool workers;
+    SPHFluid fluid;
+    DepthSorter sorter;
+    
+    WaterParticleSystem() : fluid(PARTICLE_COUNT, workers), sorter(workers) {
+        // SPH 每个子步都按单元重排粒子下标, 上一帧的顺序用不上
+        sorter.setIncremental(false);
         
         renderProgram = createShaderProgram(waterVertexShaderSource, waterFragmentShaderSource, waterGeometryShaderSource);
         
-        // 创建SSBO
+        // 创建SSBO, 内容每帧整体重写
         glGenBuffers(1, &ssbo);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(WaterParticle) * PARTICLE_COUNT, particles, GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(WaterParticle) * PARTICLE_COUNT, nullptr, GL_DYNAMIC_DRAW);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        
+        // 粒子没有顶点属性, VAO 只记录索引缓冲
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * PARTICLE_COUNT, nullptr, GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
     }
     
-    void update(float deltaTime, float time) {
+    void update(float deltaTime) {
         // 更新粒子
-        glUseProgram(computeProgram);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
-        glUniform1f(glGetUniformLocation(computeProgram, "deltaTime"), deltaTime);
-        glUniform1f(glGetUniformLocation(computeProgram, "time"), time);
-        glUniform3f(glGetUniformLocation(computeProgram, "emitterPosition"), 0.0f, 5.0f, 0.0f);
-        glUniform3f(glGetUniformLocation(computeProgram, "gravity"), 0.0f, -9.8f, 0.0f);
-        glDispatchCompute((PARTICLE_COUNT + 255) / 256, 1, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        fluid.update(deltaTime);
+        
+        // 丢弃旧内容再映射, 驱动可以换一块新内存, 不必等上一帧绘制结束
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+        void* mapped = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sizeof(WaterParticle) * PARTICLE_COUNT,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            fluid.writeParticles(static_cast<WaterParticle*>(mapped));
+            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
     
     void render(const glm::mat4& view, const glm::mat4& projection, float time) {
+        // 活着的粒子都在 [0, activeCount), 按深度从远到近排好后作为索引缓冲
+        const std::vector<uint32_t>& order = sorter.sort(fluid.getActiveCount(), view,
+                                                         [this](int i) { return fluid.getPosition(i); });
+        int drawCount = static_cast<int>(order.size());
+        glBindVertexArray(vao);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint32_t) * drawCount, order.data());
+        
         glUseProgram(renderProgram);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
         glUniformMatrix4fv(glGetUniformLocation(renderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
@@ -454,8 +697,10 @@ public:
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glDepthMask(GL_FALSE);
         
-        // 绘制粒子
-        glDrawArrays(GL_POINTS, 0, PARTICLE_COUNT);
+        // 按排好的顺序绘制粒子
+        glBindVertexArray(vao);
+        glDrawElements(GL_POINTS, drawCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
         
         glDepthMask(GL_TRUE);
         glDisable(GL_BLEND);
@@ -637,7 +882,7 @@ int main() {
         groundRenderer.render(view, projection);
         
         // 更新和渲染水流
-        waterSystem.update(deltaTime, currentTime);
+        waterSystem.update(deltaTime);
         waterSystem.render(view, projection, currentTime);
         
         // 渲染到屏幕
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "../fast_random.h"
 
 using namespace std;
 using namespace glm;
@@ -206,36 +207,14 @@ int main()
     vector<float> instanceScales(CUBE_COUNT);
     vector<float> instanceSpeeds(CUBE_COUNT);
     
-    // 🎰 随机数生成器
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_real_distribution<float> posRange(-50.0f, 50.0f);  // 位置范围
-    uniform_real_distribution<float> colorRange(0.3f, 1.0f);   // 颜色范围
-    uniform_real_distribution<float> scaleRange(0.2f, 1.5f);   // 缩放范围
-    uniform_real_distribution<float> speedRange(0.5f, 3.0f);   // 速度范围
-    
-    // 🌈 生成每个立方体的属性
-    for (int i = 0; i < CUBE_COUNT; i++) {
-        // 随机位置
-        instancePositions[i] = vec3(
-            posRange(gen),
-            posRange(gen),
-            posRange(gen)
-        );
-        
-        // 随机颜色
-        instanceColors[i] = vec3(
-            colorRange(gen),
-            colorRange(gen),
-            colorRange(gen)
-        );
-        
-        // 随机缩放
-        instanceScales[i] = scaleRange(gen);
-        
-        // 随机旋转速度
-        instanceSpeeds[i] = speedRange(gen);
-    }
+    // 🎰 随机数生成器 (计数器型, 整块批量生成)
+    CounterRng rng(random_device{}());
+    
+    // 🌈 生成每个立方体的属性: vec3 数组按 3 * CUBE_COUNT 个连续 float 填充
+    rng.fillUniform(value_ptr(instancePositions[0]), 3 * CUBE_COUNT, -50.0f, 50.0f); // 随机位置
+    rng.fillUniform(value_ptr(instanceColors[0]), 3 * CUBE_COUNT, 0.3f, 1.0f);      // 随机颜色
+    rng.fillUniform(instanceScales.data(), CUBE_COUNT, 0.2f, 1.5f);                 // 随机缩放
+    rng.fillUniform(instanceSpeeds.data(), CUBE_COUNT, 0.5f, 3.0f);                 // 随机旋转速度
     
     cout << "✅ 实例数据生成完成!" << endl;
     
@@ -9,6 +9,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "../fast_random.h"
 #define PI 3.14159265359
 using namespace std;
 using namespace glm;
@@ -33,6 +34,11 @@ float last_y = WINDOW_HEIGHT / 2.0f;
 float delta_time = 0.0f;
 float last_frame = 0.0f;
 
+// 固定物理步长：物理按固定频率推进，渲染在最近两次物理状态之间插值
+const float PHYSICS_STEP = 1.0f / 120.0f;
+const int MAX_SUBSTEPS = 8; // 单帧最多补几步，卡顿时丢弃多余时间
+float physics_accumulator = 0.0f;
+
 // 高级顶点着色器 - PBR + 物理仿真
 const char* vertex_shader_source = R"(
 #version 430 core
@@ -323,6 +329,7 @@ unsigned int createShaderProgram() {
 class PhysicsSphere {
 public:
     vec3 position;
+    vec3 previousPosition; // 上一个物理步的位置，用于渲染插值
     vec3 velocity;
     vec3 color;
     float radius;
@@ -330,10 +337,12 @@ public:
     float restitution; // 弹性系数
     
     PhysicsSphere(vec3 pos, vec3 vel, vec3 col, float r, float m) 
-        : position(pos), velocity(vel), color(col), radius(r), mass(m), restitution(0.8f) {}
+        : position(pos), previousPosition(pos), velocity(vel), color(col), radius(r), mass(m), restitution(0.8f) {}
     
     // 物理更新
     void update(float deltaTime) {
+        previousPosition = position;
+        
         // 重力作用
         vec3 gravity = vec3(0.0f, -9.81f, 0.0f);
         velocity += gravity * deltaTime;
@@ -629,20 +638,14 @@ int main() {
     
     // 创建物理球体
     vector<PhysicsSphere> spheres;
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_real_distribution<float> pos_dist(-8.0f, 8.0f);
-    uniform_real_distribution<float> vel_dist(-5.0f, 5.0f);
-    uniform_real_distribution<float> color_dist(0.3f, 1.0f);
-    uniform_real_distribution<float> radius_dist(0.2f, 0.8f);
-    uniform_real_distribution<float> mass_dist(1.0f, 5.0f);
+    CounterRng rng(random_device{}());
     
     for (int i = 0; i < MAX_SPHERES; ++i) {
-        vec3 pos = vec3(pos_dist(gen), pos_dist(gen) + 5.0f, pos_dist(gen));
-        vec3 vel = vec3(vel_dist(gen), 0.0f, vel_dist(gen));
-        vec3 color = vec3(color_dist(gen), color_dist(gen), color_dist(gen));
-        float radius = radius_dist(gen);
-        float mass = mass_dist(gen);
+        vec3 pos = vec3(rng.uniform(-8.0f, 8.0f), rng.uniform(-8.0f, 8.0f) + 5.0f, rng.uniform(-8.0f, 8.0f));
+        vec3 vel = vec3(rng.uniform(-5.0f, 5.0f), 0.0f, rng.uniform(-5.0f, 5.0f));
+        vec3 color = vec3(rng.uniform(0.3f, 1.0f), rng.uniform(0.3f, 1.0f), rng.uniform(0.3f, 1.0f));
+        float radius = rng.uniform(0.2f, 0.8f);
+        float mass = rng.uniform(1.0f, 5.0f);
         
         spheres.emplace_back(pos, vel, color, radius, mass);
     }
@@ -713,23 +716,34 @@ int main() {
         // 处理输入
         processInput(window);
         
-        // 物理更新
-        for (auto& sphere : spheres) {
-            sphere.update(delta_time);
-        }
-        
-        // 碰撞检测和响应
-        for (size_t i = 0; i < spheres.size(); ++i) {
-            for (size_t j = i + 1; j < spheres.size(); ++j) {
-                if (spheres[i].checkCollision(spheres[j])) {
-                    spheres[i].resolveCollision(spheres[j]);
+        // 物理更新：按固定步长消耗累积的时间
+        physics_accumulator += delta_time;
+        int substeps = 0;
+        while (physics_accumulator >= PHYSICS_STEP && substeps < MAX_SUBSTEPS) {
+            for (auto& sphere : spheres) {
+                sphere.update(PHYSICS_STEP);
+            }
+            
+            // 碰撞检测和响应
+            for (size_t i = 0; i < spheres.size(); ++i) {
+                for (size_t j = i + 1; j < spheres.size(); ++j) {
+                    if (spheres[i].checkCollision(spheres[j])) {
+                        spheres[i].resolveCollision(spheres[j]);
+                    }
                 }
             }
+            
+            physics_accumulator -= PHYSICS_STEP;
+            substeps++;
+        }
+        if (physics_accumulator >= PHYSICS_STEP) {
+            physics_accumulator = 0.0f; // 追不上了，丢弃剩余时间
         }
+        float alpha = physics_accumulator / PHYSICS_STEP;
         
         // 更新实例化数据
         for (size_t i = 0; i < spheres.size(); ++i) {
-            instancePositions[i] = spheres[i].position;
+            instancePositions[i] = mix(spheres[i].previousPosition, spheres[i].position, alpha);
             instanceVelocities[i] = spheres[i].velocity;
             instanceColors[i] = spheres[i].color;
             instanceRadii[i] = spheres[i].radius;
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "../fast_random.h"
 
 using namespace std;
 using namespace glm;
@@ -224,24 +225,14 @@ int main()
     vector<float> instanceScales(CUBE_COUNT);
     vector<float> instanceSpeeds(CUBE_COUNT);
 
-    //设置随机数生成器
-    random_device rd;
-    mt19937 gen(rd());// 随机数引擎
+    //设置随机数生成器 (计数器型, 可以整块批量生成)
+    CounterRng rng(random_device{}());
 
-    //定义随机数分布
-    uniform_real_distribution<float>posRange(-50.0f, 50.0f); // 位置范围
-    uniform_real_distribution<float>colorRange(0.3f, 1.0f); // 颜色范围
-    uniform_real_distribution<float>scaleRange(0.1f, 1.0f); // 缩放范围
-    uniform_real_distribution<float>speedRange(0.1f, 2.0f); // 速度范围
-
-    //随机生成每个立方体的属性
-    for (int i = 0; i < CUBE_COUNT;i++)
-    {
-        instancePositions[i]=vec3(posRange(gen),posRange(gen),posRange(gen));
-        instanceColors[i]=vec3(colorRange(gen),colorRange(gen),colorRange(gen));
-        instanceScales[i]=scaleRange(gen);
-        instanceSpeeds[i]=speedRange(gen);
-    }
+    //随机生成每个立方体的属性, vec3 数组当作 3 * CUBE_COUNT 个连续 float 填充
+    rng.fillUniform(value_ptr(instancePositions[0]), 3 * CUBE_COUNT, -50.0f, 50.0f); // 位置范围
+    rng.fillUniform(value_ptr(instanceColors[0]), 3 * CUBE_COUNT, 0.3f, 1.0f); // 颜色范围
+    rng.fillUniform(instanceScales.data(), CUBE_COUNT, 0.1f, 1.0f); // 缩放范围
+    rng.fillUniform(instanceSpeeds.data(), CUBE_COUNT, 0.1f, 2.0f); // 速度范围
     cout << "All the random values have been generated!" << endl;
 
     //GPU缓冲区设置
@@ -7,23 +7,22 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <cstdlib>
 #include <ctime>
 
-const int MAX_PARTICLES = 2000;
-// Window dimensions
-const GLuint WIDTH = 800, HEIGHT = 600;
+#include "../fast_random.h"
+#include "../worker_pool.h"
 
-// Particle structure
-struct Particle {
-    glm::vec2 position;
-    glm::vec2 velocity;
-    glm::vec4 color;
-    float life;
-    float size;
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_SSE 1
+#endif
 
-    Particle() : life(0.0f), size(0.0f) {}
-};
+const int MAX_PARTICLES = 1000000;
+const float PARTICLES_PER_SECOND = 200000.0f;
+const float PARTICLE_LIFE = 3.0f; // Seconds
+const float PARTICLE_GRAVITY = 9.81f * 0.5f;
+// Window dimensions
+const GLuint WIDTH = 800, HEIGHT = 600;
 
 // Shader sources for particles
 const GLchar* vertexShaderSource = R"(
@@ -64,38 +63,211 @@ void main()
 }
 )";
 
-// Function to find an unused particle
-int findUnusedParticle(const std::vector<Particle>& particles, int& lastUsedParticle) {
-    for (int i = lastUsedParticle; i < MAX_PARTICLES; i++) {
-        if (particles[i].life <= 0.0f) {
-            lastUsedParticle = i;
-            return i;
+// Fixed-capacity particle pool stored as structure of arrays: every
+// attribute is its own packed column, so update advances 4 particles per SSE
+// instruction. Live particles always occupy [0, size()) with no gaps and
+// spawn fills the slot just past the last live one; the dead tail is the
+// free list.
+//
+// update runs in fixed-size chunks on a WorkerPool. A first pass counts the
+// survivors of each chunk, an exclusive prefix sum over those counts gives
+// every chunk its output offset, and a second pass advances the survivors
+// and writes them, in their original order, to that offset in both the
+// vertex stream and a second set of columns, which then become the live
+// ones. Chunks never share output, so nothing is locked, and the result is
+// the same for any thread count.
+//
+// Alpha and point size are not stored; both fall off linearly with the
+// remaining life and are computed while writing the vertices.
+class ParticlePool {
+public:
+    // Multiple of the SSE width so every chunk starts on a full group.
+    static const int CHUNK_SIZE = 16384;
+
+    explicit ParticlePool(int capacity) : liveCount(0) {
+        front.resize(capacity);
+        back.resize(capacity);
+    }
+
+    // Returns false when every particle is alive.
+    bool spawn(glm::vec2 position, glm::vec2 velocity, glm::vec3 color) {
+        if (liveCount == capacity()) {
+            return false;
         }
+        int i = liveCount++;
+        front.positionX[i] = position.x;
+        front.positionY[i] = position.y;
+        front.velocityX[i] = velocity.x;
+        front.velocityY[i] = velocity.y;
+        front.red[i] = color.r;
+        front.green[i] = color.g;
+        front.blue[i] = color.b;
+        front.life[i] = PARTICLE_LIFE;
+        return true;
     }
-    for (int i = 0; i < lastUsedParticle; i++) {
-        if (particles[i].life <= 0.0f) {
-            lastUsedParticle = i;
-            return i;
+
+    // Advances every live particle, drops the ones whose life ran out and
+    // writes the survivors' vertices to out: 7 floats each (position, color
+    // with alpha, size), the layout of the VBO. Returns the number of
+    // vertices written, which is the new size().
+    int update(float deltaTime, GLfloat* out, WorkerPool& workers) {
+        int chunkCount = (liveCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunkOffsets.assign(chunkCount + 1, 0);
+
+        workers.run(liveCount, CHUNK_SIZE, [&](int begin, int end) {
+            int survivors = 0;
+            for (int i = begin; i < end; i++) {
+                survivors += front.life[i] - deltaTime > 0.0f;
+            }
+            chunkOffsets[begin / CHUNK_SIZE + 1] = survivors;
+        });
+        for (int c = 0; c < chunkCount; c++) {
+            chunkOffsets[c + 1] += chunkOffsets[c];
         }
+
+        workers.run(liveCount, CHUNK_SIZE, [&](int begin, int end) {
+            updateRange(begin, end, chunkOffsets[begin / CHUNK_SIZE], deltaTime, out);
+        });
+        std::swap(front, back);
+        liveCount = chunkOffsets[chunkCount];
+        return liveCount;
     }
-    return -1; // All particles are alive
-}
 
-void respawnParticle(Particle &particle, glm::vec2 offset = glm::vec2(0.0f, 0.0f)) {
-    float random = ((rand() % 100) - 50) / 10.0f;
-    float rColor = 0.5f + ((rand() % 100) / 100.0f);
+    int size() const { return liveCount; }
+    int capacity() const { return (int)front.life.size(); }
+
+private:
+    struct Columns {
+        std::vector<float> positionX, positionY;
+        std::vector<float> velocityX, velocityY;
+        std::vector<float> red, green, blue;
+        std::vector<float> life;
+
+        void resize(int capacity) {
+            for (std::vector<float>* column : { &positionX, &positionY, &velocityX, &velocityY, &red, &green, &blue, &life }) {
+                column->resize(capacity);
+            }
+        }
+    };
+
+    // Moves the particle at i to slot w of the back columns and the vertex
+    // stream; life, velocity and position are already advanced.
+    void writeParticle(int i, int w, float l, float vy, float px, float py, GLfloat* out) {
+        back.positionX[w] = px;
+        back.positionY[w] = py;
+        back.velocityX[w] = front.velocityX[i];
+        back.velocityY[w] = vy;
+        back.red[w] = front.red[i];
+        back.green[w] = front.green[i];
+        back.blue[w] = front.blue[i];
+        back.life[w] = l;
+
+        float alpha = l * (1.0f / PARTICLE_LIFE);
+        GLfloat* v = out + w * 7;
+        v[0] = px;
+        v[1] = py;
+        v[2] = front.red[i];
+        v[3] = front.green[i];
+        v[4] = front.blue[i];
+        v[5] = alpha;
+        v[6] = alpha * 20.0f;
+    }
+
+    void updateOne(int i, int& w, float deltaTime, GLfloat* out) {
+        // Same operation order as the SSE path, so both give identical results
+        float l = front.life[i] - deltaTime;
+        if (l > 0.0f) {
+            float vy = front.velocityY[i] - PARTICLE_GRAVITY * deltaTime;
+            float px = front.positionX[i] + front.velocityX[i] * deltaTime;
+            float py = front.positionY[i] + vy * deltaTime;
+            writeParticle(i, w++, l, vy, px, py, out);
+        }
+    }
+
+    // Survivors of [begin, end) go to consecutive slots starting at w.
+    void updateRange(int begin, int end, int w, float deltaTime, GLfloat* out) {
+        int i = begin;
+#ifdef PARTICLES_SSE
+        const __m128 dt = _mm_set1_ps(deltaTime);
+        const __m128 fall = _mm_set1_ps(PARTICLE_GRAVITY * deltaTime);
+        const __m128 scale = _mm_set1_ps(1.0f / PARTICLE_LIFE);
+        const __m128 maxSize = _mm_set1_ps(20.0f);
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= end; i += 4) {
+            __m128 l = _mm_sub_ps(_mm_loadu_ps(&front.life[i]), dt);
+            if (_mm_movemask_ps(_mm_cmpgt_ps(l, zero)) != 0xF) {
+                // A particle in this group dies; compact it one by one
+                for (int k = i; k < i + 4; k++) {
+                    updateOne(k, w, deltaTime, out);
+                }
+                continue;
+            }
+            __m128 vx = _mm_loadu_ps(&front.velocityX[i]);
+            __m128 vy = _mm_sub_ps(_mm_loadu_ps(&front.velocityY[i]), fall);
+            __m128 px = _mm_add_ps(_mm_loadu_ps(&front.positionX[i]), _mm_mul_ps(vx, dt));
+            __m128 py = _mm_add_ps(_mm_loadu_ps(&front.positionY[i]), _mm_mul_ps(vy, dt));
+            __m128 r = _mm_loadu_ps(&front.red[i]);
+            __m128 g = _mm_loadu_ps(&front.green[i]);
+            __m128 b = _mm_loadu_ps(&front.blue[i]);
+            _mm_storeu_ps(&back.life[w], l);
+            _mm_storeu_ps(&back.velocityX[w], vx);
+            _mm_storeu_ps(&back.velocityY[w], vy);
+            _mm_storeu_ps(&back.positionX[w], px);
+            _mm_storeu_ps(&back.positionY[w], py);
+            _mm_storeu_ps(&back.red[w], r);
+            _mm_storeu_ps(&back.green[w], g);
+            _mm_storeu_ps(&back.blue[w], b);
+
+            __m128 alpha = _mm_mul_ps(l, scale);
+            __m128 size = _mm_mul_ps(alpha, maxSize);
+
+            // Transpose the columns into two rows per particle,
+            // (x, y, r, g) and (b, a, size, size), and store them 7 floats
+            // apart; each second row's spare lane is overwritten by the next
+            // particle's first row
+            __m128 first0 = px, first1 = py, first2 = r, first3 = g;
+            __m128 second0 = b, second1 = alpha, second2 = size, second3 = size;
+            _MM_TRANSPOSE4_PS(first0, first1, first2, first3);
+            _MM_TRANSPOSE4_PS(second0, second1, second2, second3);
+            GLfloat* v = out + w * 7;
+            _mm_storeu_ps(v + 0, first0);
+            _mm_storeu_ps(v + 4, second0);
+            _mm_storeu_ps(v + 7, first1);
+            _mm_storeu_ps(v + 11, second1);
+            _mm_storeu_ps(v + 14, first2);
+            _mm_storeu_ps(v + 18, second2);
+            _mm_storeu_ps(v + 21, first3);
+            // The last row must not spill into the next group
+            _mm_storel_pi(reinterpret_cast<__m64*>(v + 25), second3);
+            _mm_store_ss(v + 27, _mm_movehl_ps(second3, second3));
+            w += 4;
+        }
+#endif
+        for (; i < end; i++) {
+            updateOne(i, w, deltaTime, out);
+        }
+    }
+
+    Columns front; // Live particles
+    Columns back;  // Target of the next update
+    std::vector<int> chunkOffsets;
+    int liveCount;
+};
+
+// Returns false when the pool is full.
+bool respawnParticle(ParticlePool& particles, CounterRng& rng, glm::vec2 offset = glm::vec2(0.0f, 0.0f)) {
+    float random = rng.uniform(-5.0f, 5.0f);
+    float rColor = rng.uniform(0.5f, 1.5f);
     
-    particle.position = glm::vec2(0.0f, -0.8f) + offset;
-    particle.velocity = glm::vec2(random, 1.0f + (rand() % 50) / 10.0f);
-    particle.color = glm::vec4(rColor, rColor * 0.5f, 0.2f, 1.0f);
-    particle.life = 3.0f; // Particle lives for 3 seconds
-    particle.size = 15.0f + (rand() % 10);
+    glm::vec2 position = glm::vec2(0.0f, -0.8f) + offset;
+    glm::vec2 velocity = glm::vec2(random, rng.uniform(1.0f, 6.0f));
+    return particles.spawn(position, velocity, glm::vec3(rColor, rColor * 0.5f, 0.2f));
 }
 
 int main()
 {
     // Initialize random seed
-    srand(static_cast<unsigned int>(time(nullptr)));
+    CounterRng rng(static_cast<uint64_t>(time(nullptr)));
 
     // Init GLFW
     if (!glfwInit()) {
@@ -168,8 +340,8 @@ int main()
     glDeleteShader(fragmentShader);
 
     // Particle data
-    std::vector<Particle> particles(MAX_PARTICLES);
-    int lastUsedParticle = 0;
+    ParticlePool particles(MAX_PARTICLES);
+    WorkerPool workers;
     
     // Create VAO and VBO for particles
     GLuint VAO, VBO;
@@ -222,49 +394,15 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
         
         // Generate new particles
-        int newParticles = (int)(deltaTime * 2000.0); // 2000 particles per second
+        int newParticles = (int)(deltaTime * PARTICLES_PER_SECOND);
         for (int i = 0; i < newParticles; i++) {
-            int particleIndex = findUnusedParticle(particles, lastUsedParticle);
-            if (particleIndex != -1) {
-                respawnParticle(particles[particleIndex]);
+            if (!respawnParticle(particles, rng)) {
+                break; // Pool is full
             }
         }
         
-        // Update all particles
-        int particlesCount = 0;
-        for (int i = 0; i < MAX_PARTICLES; i++) {
-            Particle& p = particles[i];
-            
-            if (p.life > 0.0f) {
-                // Decrease life
-                p.life -= deltaTime;
-                
-                if (p.life > 0.0f) {
-                    // Update particle physics
-                    p.velocity.y -= 9.81f * deltaTime * 0.5f; // Gravity
-                    p.position += p.velocity * deltaTime;
-                    
-                    // Update color (fade out)
-                    p.color.a = p.life / 3.0f;
-                    
-                    // Update size based on life
-                    p.size = 20.0f * (p.life / 3.0f);
-                    
-                    // Add particle to buffer
-                    particle_vertex_buffer_data[particlesCount * 7 + 0] = p.position.x;
-                    particle_vertex_buffer_data[particlesCount * 7 + 1] = p.position.y;
-                    particle_vertex_buffer_data[particlesCount * 7 + 2] = p.color.r;
-                    particle_vertex_buffer_data[particlesCount * 7 + 3] = p.color.g;
-                    particle_vertex_buffer_data[particlesCount * 7 + 4] = p.color.b;
-                    particle_vertex_buffer_data[particlesCount * 7 + 5] = p.color.a;
-                    particle_vertex_buffer_data[particlesCount * 7 + 6] = p.size;
-                    
-                    particlesCount++;
-                } else {
-                    p.color.a = 0.0f;
-                }
-            }
-        }
+        // Update all live particles and pack their vertices
+        int particlesCount = particles.update(deltaTime, particle_vertex_buffer_data.data(), workers);
         
         // Use shader program
         glUseProgram(shaderProgram);
@@ -0,0 +1,330 @@
+#ifndef FAST_RANDOM_H
+#define FAST_RANDOM_H
+
+// Counter-based random numbers for particle emitters and scene generation.
+//
+// CounterRng is Philox4x32-10 (Salmon et al., "Parallel random numbers: as
+// easy as 1, 2, 3", 2011): every 128-bit block is a pure function of a key
+// (the seed) and a counter (stream id and block index). Nothing is shared
+// between generators, so each thread or emitter simply owns one with its
+// own stream id, and any block can be computed directly without stepping
+// through the ones before it.
+//
+// fillUniform and fillNormal generate 4 blocks at a time with SSE2 and give
+// the same results as the scalar fallback, bit for bit as long as the
+// compiler doesn't fuse multiply-adds (-mfma). Normals use Box-Muller with
+// polynomial log, sine and cosine, within a few float ulps of libm.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FAST_RANDOM_SSE2 1
+#endif
+
+class CounterRng {
+public:
+    // Generators with the same seed and different streams never overlap.
+    explicit CounterRng(uint64_t seed, uint64_t stream = 0)
+        : key0(static_cast<uint32_t>(seed)), key1(static_cast<uint32_t>(seed >> 32)),
+          stream(stream), block(0), used(4), spareNormal(0.0f), hasSpareNormal(false) {}
+
+    // One Philox4x32-10 block.
+    static void philox(const uint32_t counter[4], uint32_t key0, uint32_t key1, uint32_t out[4]) {
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        for (int round = 0; round < 10; round++) {
+            uint64_t product0 = static_cast<uint64_t>(MULTIPLIER0) * c0;
+            uint64_t product1 = static_cast<uint64_t>(MULTIPLIER1) * c2;
+            uint32_t hi0 = static_cast<uint32_t>(product0 >> 32), lo0 = static_cast<uint32_t>(product0);
+            uint32_t hi1 = static_cast<uint32_t>(product1 >> 32), lo1 = static_cast<uint32_t>(product1);
+            c0 = hi1 ^ c1 ^ key0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ key1;
+            c3 = lo0;
+            key0 += WEYL0;
+            key1 += WEYL1;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+
+    // Jumps to any block; the rest of the current one is discarded.
+    void seek(uint64_t blockIndex) {
+        block = blockIndex;
+        used = 4;
+        hasSpareNormal = false;
+    }
+
+    uint32_t nextUint() {
+        if (used == 4) {
+            generateBlock(block++, buffer);
+            used = 0;
+        }
+        return buffer[used++];
+    }
+
+    // [0, 1) with 24 bits of resolution.
+    float nextFloat() { return toUnitFloat(nextUint()); }
+
+    float uniform(float min, float max) { return min + (max - min) * nextFloat(); }
+
+    float normal(float mean = 0.0f, float stddev = 1.0f) {
+        if (hasSpareNormal) {
+            hasSpareNormal = false;
+            return mean + stddev * spareNormal;
+        }
+        float first, second;
+        boxMuller(nextUint(), nextUint(), first, second);
+        spareNormal = second;
+        hasSpareNormal = true;
+        return mean + stddev * first;
+    }
+
+    // Bulk fills discard what is left of the current block, then consume
+    // ceil(count / 4) fresh blocks, so their output only depends on the
+    // seed, stream and starting block.
+    void fillUniform(float* out, size_t count, float min, float max) {
+        float scale = max - min;
+        size_t i = 0;
+        uint64_t base = block;
+#ifdef FAST_RANDOM_SSE2
+        const __m128 offset = _mm_set1_ps(min);
+        const __m128 range = _mm_set1_ps(scale);
+        for (; i + 16 <= count; i += 16, base += 4) {
+            __m128i words[4];
+            generateBlocksSSE2(base, words);
+            __m128 values[4];
+            for (int w = 0; w < 4; w++) {
+                values[w] = _mm_add_ps(offset, _mm_mul_ps(range, toUnitFloatSSE2(words[w])));
+            }
+            // Back to block order: row b holds the 4 words of block b
+            _MM_TRANSPOSE4_PS(values[0], values[1], values[2], values[3]);
+            for (int b = 0; b < 4; b++) {
+                _mm_storeu_ps(out + i + b * 4, values[b]);
+            }
+        }
+#endif
+        for (; i < count; i += 4, base++) {
+            uint32_t words[4];
+            generateBlock(base, words);
+            for (size_t w = 0; w < 4 && i + w < count; w++) {
+                out[i + w] = min + scale * toUnitFloat(words[w]);
+            }
+        }
+        seek(base);
+    }
+
+    void fillNormal(float* out, size_t count, float mean = 0.0f, float stddev = 1.0f) {
+        size_t i = 0;
+        uint64_t base = block;
+#ifdef FAST_RANDOM_SSE2
+        const __m128 center = _mm_set1_ps(mean);
+        const __m128 spread = _mm_set1_ps(stddev);
+        for (; i + 16 <= count; i += 16, base += 4) {
+            __m128i words[4];
+            generateBlocksSSE2(base, words);
+            // Words 0 and 1 of a block make one pair of normals, 2 and 3 the next
+            for (int w = 0; w < 4; w += 2) {
+                __m128 first, second;
+                boxMullerSSE2(words[w], words[w + 1], first, second);
+                first = _mm_add_ps(center, _mm_mul_ps(spread, first));
+                second = _mm_add_ps(center, _mm_mul_ps(spread, second));
+                // Back to block order: word w of blocks 0..3 lands at 4 * block + w
+                __m128 low = _mm_unpacklo_ps(first, second);   // block 0, block 1
+                __m128 high = _mm_unpackhi_ps(first, second);  // block 2, block 3
+                float* o = out + i + w;
+                _mm_storel_pi(reinterpret_cast<__m64*>(o), low);
+                _mm_storeh_pi(reinterpret_cast<__m64*>(o + 4), low);
+                _mm_storel_pi(reinterpret_cast<__m64*>(o + 8), high);
+                _mm_storeh_pi(reinterpret_cast<__m64*>(o + 12), high);
+            }
+        }
+#endif
+        for (; i < count; i += 4, base++) {
+            uint32_t words[4];
+            generateBlock(base, words);
+            float values[4];
+            boxMuller(words[0], words[1], values[0], values[1]);
+            boxMuller(words[2], words[3], values[2], values[3]);
+            for (size_t w = 0; w < 4 && i + w < count; w++) {
+                out[i + w] = mean + stddev * values[w];
+            }
+        }
+        seek(base);
+    }
+
+private:
+    static const uint32_t MULTIPLIER0 = 0xD2511F53u;
+    static const uint32_t MULTIPLIER1 = 0xCD9E8D57u;
+    static const uint32_t WEYL0 = 0x9E3779B9u;
+    static const uint32_t WEYL1 = 0xBB67AE85u;
+
+    void generateBlock(uint64_t index, uint32_t out[4]) const {
+        const uint32_t counter[4] = {
+            static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+            static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)
+        };
+        philox(counter, key0, key1, out);
+    }
+
+    static float toUnitFloat(uint32_t word) {
+        return static_cast<float>(word >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // ln(x) for x in (0, 1]: x = 2^e * m with m in [sqrt(1/2), sqrt(2)),
+    // ln(m) = 2 atanh(s) with s = (m - 1) / (m + 1), |s| < 0.172.
+    static float logUnit(float x) {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int32_t exponent = static_cast<int32_t>(bits >> 23) - 127;
+        bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        if (m > 1.41421356f) {
+            m = m * 0.5f;
+            exponent = exponent + 1;
+        }
+        float s = (m - 1.0f) / (m + 1.0f);
+        float s2 = s * s;
+        float series = ((((1.0f / 9.0f) * s2 + (1.0f / 7.0f)) * s2 + (1.0f / 5.0f)) * s2 + (1.0f / 3.0f)) * s2 + 1.0f;
+        return static_cast<float>(exponent) * 0.693147181f + 2.0f * s * series;
+    }
+
+    // sin(x) for |x| <= pi / 2, Taylor series to x^11.
+    static float sinHalfPi(float x) {
+        float x2 = x * x;
+        float series = ((((-2.50521084e-8f * x2 + 2.75573192e-6f) * x2 - 1.98412698e-4f) * x2 + 8.33333333e-3f) * x2 - 1.66666667e-1f) * x2 + 1.0f;
+        return x * series;
+    }
+
+    // cos(x) for |x| <= pi / 2, Taylor series to x^12.
+    static float cosHalfPi(float x) {
+        float x2 = x * x;
+        float series = (((((2.08767570e-9f * x2 - 2.75573192e-7f) * x2 + 2.48015873e-5f) * x2 - 1.38888889e-3f) * x2 + 4.16666667e-2f) * x2 - 0.5f) * x2;
+        return series + 1.0f;
+    }
+
+    // Two independent normals from two words. The angle is kept in
+    // [-pi, pi) and halved, so the half-range polynomials and the double
+    // angle formulas cover it.
+    static void boxMuller(uint32_t word0, uint32_t word1, float& first, float& second) {
+        float u = static_cast<float>((word0 >> 8) + 1) * (1.0f / 16777216.0f); // (0, 1]
+        float radius = std::sqrt(-2.0f * logUnit(u));
+        float halfAngle = (toUnitFloat(word1) - 0.5f) * 3.14159265f;
+        float s = sinHalfPi(halfAngle);
+        float c = cosHalfPi(halfAngle);
+        first = radius * (1.0f - 2.0f * (s * s));
+        second = radius * (2.0f * s * c);
+    }
+
+#ifdef FAST_RANDOM_SSE2
+    // Low and high halves of 4 lanes times a 32-bit constant.
+    static void mulhilo(__m128i a, __m128i multiplier, __m128i& hi, __m128i& lo) {
+        __m128i even = _mm_mul_epu32(a, multiplier);                     // lo0 hi0 lo2 hi2
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), multiplier);   // lo1 hi1 lo3 hi3
+        even = _mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));         // lo0 lo2 hi0 hi2
+        odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));           // lo1 lo3 hi1 hi3
+        lo = _mm_unpacklo_epi32(even, odd);
+        hi = _mm_unpackhi_epi32(even, odd);
+    }
+
+    // Blocks base..base + 3; words[w] holds word w of each block.
+    void generateBlocksSSE2(uint64_t base, __m128i words[4]) const {
+        uint64_t indices[4] = { base, base + 1, base + 2, base + 3 };
+        __m128i c0 = _mm_setr_epi32(static_cast<int>(indices[0]), static_cast<int>(indices[1]),
+                                    static_cast<int>(indices[2]), static_cast<int>(indices[3]));
+        __m128i c1 = _mm_setr_epi32(static_cast<int>(indices[0] >> 32), static_cast<int>(indices[1] >> 32),
+                                    static_cast<int>(indices[2] >> 32), static_cast<int>(indices[3] >> 32));
+        __m128i c2 = _mm_set1_epi32(static_cast<int>(stream));
+        __m128i c3 = _mm_set1_epi32(static_cast<int>(stream >> 32));
+        const __m128i multiplier0 = _mm_set1_epi32(static_cast<int>(MULTIPLIER0));
+        const __m128i multiplier1 = _mm_set1_epi32(static_cast<int>(MULTIPLIER1));
+        uint32_t k0 = key0, k1 = key1;
+        for (int round = 0; round < 10; round++) {
+            __m128i hi0, lo0, hi1, lo1;
+            mulhilo(c0, multiplier0, hi0, lo0);
+            mulhilo(c2, multiplier1, hi1, lo1);
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(static_cast<int>(k0)));
+            c1 = lo1;
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(static_cast<int>(k1)));
+            c3 = lo0;
+            k0 += WEYL0;
+            k1 += WEYL1;
+        }
+        words[0] = c0;
+        words[1] = c1;
+        words[2] = c2;
+        words[3] = c3;
+    }
+
+    static __m128 toUnitFloatSSE2(__m128i words) {
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(words, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+    }
+
+    static __m128 logUnitSSE2(__m128 x) {
+        __m128i bits = _mm_castps_si128(x);
+        __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+        __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+                                                 _mm_set1_epi32(0x3F800000)));
+        __m128 large = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+        m = _mm_or_ps(_mm_and_ps(large, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(large, m));
+        exponent = _mm_sub_epi32(exponent, _mm_castps_si128(large)); // the mask is -1
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 s = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+        __m128 s2 = _mm_mul_ps(s, s);
+        __m128 series = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f / 9.0f), s2), _mm_set1_ps(1.0f / 7.0f));
+        series = _mm_add_ps(_mm_mul_ps(series, s2), _mm_set1_ps(1.0f / 5.0f));
+        series = _mm_add_ps(_mm_mul_ps(series, s2), _mm_set1_ps(1.0f / 3.0f));
+        series = _mm_add_ps(_mm_mul_ps(series, s2), one);
+        return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(exponent), _mm_set1_ps(0.693147181f)),
+                          _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), s), series));
+    }
+
+    static __m128 sinHalfPiSSE2(__m128 x) {
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 series = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.50521084e-8f), x2), _mm_set1_ps(2.75573192e-6f));
+        series = _mm_sub_ps(_mm_mul_ps(series, x2), _mm_set1_ps(1.98412698e-4f));
+        series = _mm_add_ps(_mm_mul_ps(series, x2), _mm_set1_ps(8.33333333e-3f));
+        series = _mm_sub_ps(_mm_mul_ps(series, x2), _mm_set1_ps(1.66666667e-1f));
+        series = _mm_add_ps(_mm_mul_ps(series, x2), _mm_set1_ps(1.0f));
+        return _mm_mul_ps(x, series);
+    }
+
+    static __m128 cosHalfPiSSE2(__m128 x) {
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 series = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.08767570e-9f), x2), _mm_set1_ps(2.75573192e-7f));
+        series = _mm_add_ps(_mm_mul_ps(series, x2), _mm_set1_ps(2.48015873e-5f));
+        series = _mm_sub_ps(_mm_mul_ps(series, x2), _mm_set1_ps(1.38888889e-3f));
+        series = _mm_add_ps(_mm_mul_ps(series, x2), _mm_set1_ps(4.16666667e-2f));
+        series = _mm_sub_ps(_mm_mul_ps(series, x2), _mm_set1_ps(0.5f));
+        return _mm_add_ps(_mm_mul_ps(series, x2), _mm_set1_ps(1.0f));
+    }
+
+    static void boxMullerSSE2(__m128i words0, __m128i words1, __m128& first, __m128& second) {
+        __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_srli_epi32(words0, 8), _mm_set1_epi32(1))),
+                              _mm_set1_ps(1.0f / 16777216.0f));
+        __m128 radius = _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), logUnitSSE2(u)));
+        __m128 halfAngle = _mm_mul_ps(_mm_sub_ps(toUnitFloatSSE2(words1), _mm_set1_ps(0.5f)), _mm_set1_ps(3.14159265f));
+        __m128 s = sinHalfPiSSE2(halfAngle);
+        __m128 c = cosHalfPiSSE2(halfAngle);
+        first = _mm_mul_ps(radius, _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(2.0f), _mm_mul_ps(s, s))));
+        second = _mm_mul_ps(radius, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), s), c));
+    }
+#endif
+
+    uint32_t key0;
+    uint32_t key1;
+    uint64_t stream;
+    uint64_t block; // Next block to generate
+    uint32_t buffer[4];
+    int used;       // Words of buffer already returned
+    float spareNormal;
+    bool hasSpareNormal;
+};
+
+#endif // FAST_RANDOM_H
@@ -0,0 +1,105 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small persistent thread pool: run splits [0, count) into grain-sized
+// ranges that the calling thread and the workers take turns claiming, and
+// returns once all of them are done. Range boundaries only depend on count
+// and grain, never on the thread count, so per-range results merged in
+// range order come out the same on any machine.
+class WorkerPool {
+public:
+    using RangeFunction = std::function<void(int, int)>;
+
+    WorkerPool() {
+        unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void run(int count, int grain, const RangeFunction& function) {
+        if (workers.empty() || count <= grain) {
+            for (int begin = 0; begin < count; begin += grain) {
+                function(begin, std::min(begin + grain, count));
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &function;
+            jobCount = count;
+            jobGrain = grain;
+            next = 0;
+            busy = static_cast<int>(workers.size());
+            ++generation;
+        }
+        wake.notify_all();
+        work();
+        // Wait for every worker to check in so none still uses function
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+    }
+
+private:
+    void work() {
+        for (;;) {
+            int begin = next.fetch_add(jobGrain);
+            if (begin >= jobCount) {
+                return;
+            }
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        }
+    }
+
+    void workerLoop() {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const RangeFunction* job = nullptr;
+    int jobCount = 0;
+    int jobGrain = 1;
+    std::atomic<int> next{0};
+    int busy = 0;
+    unsigned long long generation = 0;
+    bool stopping = false;
+};
+
+#endif // WORKER_POOL_H